@@ -0,0 +1,555 @@
+#include "../include/ast.h"
+#include "../include/flat_ast.h"
+#include "../include/intern.h"
+#include "../include/lexer.h"
+#include "../include/literal.h"
+#include "../include/memory.h"
+#include "../include/parser.h"
+#include "../include/scan.h"
+#include "../include/typechecker.h"
+#include "../include/types.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Benchmarks of the front-end on generated programs. The inputs are built in
+// memory from fixed seeds, `--emit NAME` writes one out to run the binary on.
+//
+//   bench [NAME...]      runs the named benchmarks, or all of them
+//   bench --emit NAME    prints the input of NAME to stdout
+
+#define RUNS 5
+
+// =============== Inputs ===============
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} text_t;
+
+static void append(text_t* text, const char* format, ...) {
+    for(;;) {
+        va_list args;
+        va_start(args, format);
+        const int length = vsnprintf(text->data + text->size, text->capacity - text->size, format, args);
+        va_end(args);
+
+        if(length < 0) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+
+        // The lexer needs a NUL and LEXER_PADDING readable bytes after the source.
+        if(text->size + (size_t)length + 1 + LEXER_PADDING <= text->capacity) {
+            text->size += (size_t)length;
+            return;
+        }
+
+        text->capacity = text->capacity != 0 ? text->capacity * 2 : 64 * 1024;
+        text->data = realloc(text->data, text->capacity);
+
+        if(text->data == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static string_view_t text_view(text_t* text) {
+    memset(text->data + text->size, 0, 1 + LEXER_PADDING);
+    return new_string_view(text->data, text->size);
+}
+
+static uint64_t seed;
+
+static uint64_t next_random() {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    return seed;
+}
+
+static uint32_t random_below(uint32_t n) {
+    return (uint32_t)(next_random() % n);
+}
+
+// Distinct names: x, then the index in base 26.
+static const char* name(size_t index, char buffer[static 16]) {
+    char* it = buffer;
+    *it++ = 'x';
+
+    for(index++; index != 0; index = (index - 1) / 26) {
+        *it++ = (char)('a' + (index - 1) % 26);
+    }
+
+    *it = '\0';
+    return buffer;
+}
+
+// Declarations of every kind, in groups of five: an array, an inferred float,
+// a bool, and two statements using the first two.
+static void generate_declarations(text_t* text, size_t count) {
+    char a[16], b[16];
+
+    for(size_t i = 0; i < count; i++) {
+        switch(i % 5) {
+            case 0:
+                append(text, "var v%s integer[3][3] = { {1, 2, 3}, {4, 5, 6}, {7, 8, 9} };\n", name(i, a));
+                break;
+            case 1:
+                append(text, "let f%s = 3.5 * (2 + 1) - 4 / 2; # comment %zu\n", name(i, a), i);
+                break;
+            case 2:
+                append(text, "var b%s bool = true;\n", name(i, a));
+                break;
+            case 3:
+                name(i - 3, a);
+                append(text, "v%s[1][2] = v%s[0][0] + 7 * 2;\n", a, a);
+                break;
+            case 4:
+                name(i - 3, b);
+                append(text, "if f%s <= 9.1 then f%s = 1.5; else f%s = -(2 as float);\n", b, b, b);
+                break;
+        }
+    }
+}
+
+// =============== Timing ===============
+
+static double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Bytes allocated from the arena so far.
+static size_t arena_used(const arena_t* arena) {
+    size_t used = 0;
+    for(const arena_chunk_t* chunk = arena->current; chunk != NULL; chunk = chunk->prev) {
+        used += chunk->used;
+    }
+
+    return used;
+}
+
+static const ast_node_t* parse_text(text_t* text) {
+    const token_buffer_t tokens = tokenize(text_view(text));
+    parser_t p = init_parser_from_tokens(&tokens);
+
+    const ast_node_t* const program = parse_program(&p);
+    destroy_parser(&p);
+
+    return program;
+}
+
+// =============== Symbol table ===============
+
+// Typechecking binds and looks up every name once, so its time per
+// declaration stays flat as the program grows.
+static void bench_symbols(bool emit) {
+    text_t text = {0};
+
+    if(emit) {
+        generate_declarations(&text, 200000);
+        fwrite(text.data, 1, text.size, stdout);
+        free(text.data);
+        return;
+    }
+
+    printf("symbols: typecheck of generated declarations, best of %d\n", RUNS);
+
+    for(size_t count = 25000; count <= 200000; count *= 2) {
+        text.size = 0;
+        generate_declarations(&text, count);
+
+        arena_t* const arena = active_arena();
+        const arena_mark_t mark = arena_mark(arena);
+        const ast_node_t* const program = parse_text(&text);
+
+        double best = 1e9;
+        for(int run = 0; run < RUNS; run++) {
+            typechecker_t tcheck = create_typechecker();
+
+            const double start = now();
+            typecheck_ast(program, &tcheck);
+            const double time = now() - start;
+
+            if(time < best) best = time;
+            destroy_typechecker(&tcheck);
+        }
+
+        printf("  %7zu declarations: %8.2f ms, %6.1f ns per declaration\n",
+               count, best * 1e3, best * 1e9 / (double)count);
+
+        arena_rollback(arena, mark);
+    }
+
+    printf("  %zu names interned, %zu types\n", interned_count(), types_count());
+    free(text.data);
+}
+
+// =============== Lexer ===============
+
+// Keywords, identifiers, numbers, comments and operators, one token at a time.
+static void bench_lexer(bool emit) {
+    text_t text = {0};
+    generate_declarations(&text, 500000);
+
+    if(emit) {
+        fwrite(text.data, 1, text.size, stdout);
+        free(text.data);
+        return;
+    }
+
+    const string_view_t source = text_view(&text);
+
+    size_t count = 0;
+    double best = 1e9;
+
+    for(int run = 0; run < RUNS; run++) {
+        lexer_t lex = INIT_LEXER(source);
+        count = 0;
+
+        const double start = now();
+        for(token_t token = next_token(&lex); token.type != TOK_EOF && token.type != TOK_ERR; token = next_token(&lex)) {
+            count++;
+        }
+        const double time = now() - start;
+
+        if(time < best) best = time;
+    }
+
+    printf("lexer: %zu tokens in %zu bytes, best of %d\n", count, text.size, RUNS);
+    printf("  %8.2f ms, %6.1f Mtok/s, %6.1f MB/s\n",
+           best * 1e3, (double)count / best * 1e-6, (double)text.size / best * 1e-6);
+
+    free(text.data);
+}
+
+// =============== Flat AST ===============
+
+// Node memory and typecheck time of the pointer AST against the flat one.
+static void bench_flat(bool emit) {
+    text_t text = {0};
+    generate_declarations(&text, 200000);
+
+    if(emit) {
+        fwrite(text.data, 1, text.size, stdout);
+        free(text.data);
+        return;
+    }
+
+    arena_t* const arena = active_arena();
+    const arena_mark_t mark = arena_mark(arena);
+
+    const token_buffer_t tokens = tokenize(text_view(&text));
+    parser_t p = init_parser_from_tokens(&tokens);
+
+    const size_t before = arena_used(arena);
+    const ast_node_t* const program = parse_program(&p);
+    const size_t pointer_size = arena_used(arena) - before;
+    destroy_parser(&p);
+
+    const flat_ast_t flat = flatten_ast(program);
+
+    double pointer_time = 1e9, flat_time = 1e9;
+
+    for(int run = 0; run < RUNS; run++) {
+        typechecker_t tcheck = create_typechecker();
+        double start = now();
+        typecheck_ast(program, &tcheck);
+        double time = now() - start;
+
+        if(time < pointer_time) pointer_time = time;
+        destroy_typechecker(&tcheck);
+
+        typechecker_t flat_tcheck = create_typechecker();
+        start = now();
+        typecheck_flat_ast(&flat, &flat_tcheck);
+        time = now() - start;
+
+        if(time < flat_time) flat_time = time;
+        destroy_typechecker(&flat_tcheck);
+    }
+
+    printf("flat: 200000 declarations, best of %d\n", RUNS);
+    printf("  pointer AST: %8.1f MB, typecheck %8.2f ms\n", (double)pointer_size * 1e-6, pointer_time * 1e3);
+    printf("  flat AST:    %8.1f MB, typecheck %8.2f ms\n", (double)flat_ast_size(&flat) * 1e-6, flat_time * 1e3);
+
+    arena_rollback(arena, mark);
+    free(text.data);
+}
+
+// =============== Parser ===============
+
+// Random expression of at most `depth` levels, with every operator, casts,
+// subscripts and nested assignments. The names all start with x, so none is
+// a keyword.
+static void generate_expression(text_t* text, int depth) {
+    static const char* const operators[] = { "+", "-", "*", "/", "<", ">", "<=", ">=" };
+    static const char* const types[] = { "float", "integer", "bool" };
+
+    const uint32_t choice = random_below(10);
+
+    if(depth == 0 || choice < 2) {
+        // Subscripts and parentheses nest, they need a level left.
+        switch(random_below(depth > 0 ? 5 : 3)) {
+            case 0:
+                append(text, "x%c%c", 'a' + random_below(26), 'a' + random_below(26));
+                break;
+            case 1:
+                append(text, "%u", random_below(1000));
+                break;
+            case 2:
+                append(text, "%u.%u", random_below(100), random_below(100));
+                break;
+            case 3:
+                append(text, "x%c[", 'a' + random_below(26));
+                generate_expression(text, depth - 1);
+                append(text, "]");
+                break;
+            case 4:
+                append(text, "(");
+                generate_expression(text, depth - 1);
+                append(text, ")");
+                break;
+        }
+    } else if(choice < 7) {
+        generate_expression(text, depth - 1);
+        append(text, " %s ", operators[random_below(8)]);
+        generate_expression(text, depth - 1);
+    } else if(choice < 8) {
+        append(text, random_below(2) ? "-" : "+");
+        generate_expression(text, depth - 1);
+    } else if(choice < 9) {
+        generate_expression(text, depth - 1);
+        append(text, " as %s", types[random_below(3)]);
+    } else {
+        append(text, "(x%c = ", 'a' + random_below(26));
+        generate_expression(text, depth - 1);
+        append(text, ")");
+    }
+}
+
+static void generate_expressions(text_t* text) {
+    for(int i = 0; i < 60000; i++) {
+        generate_expression(text, 6);
+        append(text, ";\n");
+    }
+}
+
+// Initializer lists of bare names, each one used to go through every
+// level of the descent.
+static void generate_name_lists(text_t* text) {
+    char a[16];
+
+    for(size_t i = 0; i < 20000; i++) {
+        append(text, "var l%s integer[64] = {", name(i, a));
+        for(int j = 0; j < 64; j++) {
+            append(text, "%sx%c%c", j > 0 ? ", " : "", 'a' + random_below(26), 'a' + random_below(26));
+        }
+        append(text, "};\n");
+    }
+}
+
+static double time_parse(text_t* text) {
+    arena_t* const arena = active_arena();
+    const arena_mark_t start = arena_mark(arena);
+
+    const token_buffer_t tokens = tokenize(text_view(text));
+    const arena_mark_t mark = arena_mark(arena);
+
+    double best = 1e9;
+    for(int run = 0; run < RUNS; run++) {
+        parser_t p = init_parser_from_tokens(&tokens);
+
+        const double begin = now();
+        parse_program(&p);
+        const double time = now() - begin;
+
+        if(time < best) best = time;
+        destroy_parser(&p);
+        arena_rollback(arena, mark);
+    }
+
+    arena_rollback(arena, start);
+    return best;
+}
+
+// Parse time alone, from tokens lexed beforehand. The names are never
+// declared, the inputs are only meant to be parsed.
+static void bench_parser(bool emit) {
+    text_t expressions = {0}, lists = {0};
+    generate_expressions(&expressions);
+    generate_name_lists(&lists);
+
+    if(emit) {
+        fwrite(expressions.data, 1, expressions.size, stdout);
+        fwrite(lists.data, 1, lists.size, stdout);
+    } else {
+        printf("parser: tokens lexed beforehand, best of %d\n", RUNS);
+        printf("  expressions: %5.1f MB, %8.2f ms\n", (double)expressions.size * 1e-6, time_parse(&expressions) * 1e3);
+        printf("  name lists:  %5.1f MB, %8.2f ms\n", (double)lists.size * 1e-6, time_parse(&lists) * 1e3);
+    }
+
+    free(expressions.data);
+    free(lists.data);
+}
+
+// =============== Literals ===============
+
+// Initializer tables of `count` numbers, 1000 to a declaration. Floats have
+// `digits` digits after the point, integers up to 10 digits.
+static void generate_table(text_t* text, size_t count, int digits) {
+    for(size_t i = 0; i < count; i += 1000) {
+        append(text, "var t%zu %s[1000] = {", i / 1000, digits > 0 ? "float" : "integer");
+
+        for(size_t j = 0; j < 1000; j++) {
+            append(text, j > 0 ? ", " : " ");
+
+            if(digits > 0) {
+                append(text, "%u.", random_below(100));
+                for(int k = 0; k < digits; k++) append(text, "%u", random_below(10));
+            } else {
+                append(text, "%u", random_below(UINT32_MAX / 2));
+            }
+        }
+
+        append(text, " };\n");
+    }
+}
+
+// Sum of the literals of `tokens`, read with literal.h or with libc, which
+// stops at the ',' after each one.
+static double sum_literals(const token_buffer_t* tokens, bool with_libc) {
+    const char* const data = string_view_data(tokens->source);
+    double sum = 0.0;
+
+    for(size_t i = 0; i < tokens->count; i++) {
+        const string_view_t lexeme = new_string_view(data + tokens->starts[i], tokens->lengths[i]);
+
+        if(tokens->types[i] == FLOATING_LITERAL) {
+            float value = 0.0f;
+            if(with_libc) value = strtof(data + tokens->starts[i], NULL);
+            else parse_float_literal(lexeme, &value);
+
+            sum += value;
+        } else if(tokens->types[i] == INTEGER_LITERAL) {
+            int64_t value = 0;
+            if(with_libc) value = strtoll(data + tokens->starts[i], NULL, 10);
+            else parse_integer_literal(lexeme, &value);
+
+            sum += (double)value;
+        }
+    }
+
+    return sum;
+}
+
+static void time_literals(const char* label, text_t* text) {
+    arena_t* const arena = active_arena();
+    const arena_mark_t mark = arena_mark(arena);
+
+    const token_buffer_t tokens = tokenize(text_view(text));
+
+    double best[2] = { 1e9, 1e9 };
+    double sums[2] = { 0.0, 0.0 };
+
+    for(int run = 0; run < RUNS; run++) {
+        for(int with_libc = 0; with_libc < 2; with_libc++) {
+            const double start = now();
+            sums[with_libc] = sum_literals(&tokens, with_libc);
+            const double time = now() - start;
+
+            if(time < best[with_libc]) best[with_libc] = time;
+        }
+    }
+
+    printf("  %-14s %8.2f ms, libc %8.2f ms%s\n", label, best[0] * 1e3, best[1] * 1e3,
+           sums[0] == sums[1] ? "" : ", values differ");
+
+    arena_rollback(arena, mark);
+}
+
+// parse_float_literal and parse_integer_literal against strtof and strtoll,
+// on the literals of number-heavy initializer tables, lexed beforehand.
+static void bench_literals(bool emit) {
+    text_t floats = {0}, long_floats = {0}, integers = {0};
+    generate_table(&floats, 200000, 6);
+    generate_table(&long_floats, 200000, 24);
+    generate_table(&integers, 200000, 0);
+
+    if(emit) {
+        fwrite(floats.data, 1, floats.size, stdout);
+        fwrite(long_floats.data, 1, long_floats.size, stdout);
+        fwrite(integers.data, 1, integers.size, stdout);
+    } else {
+        printf("literals: 200000 of each, best of %d\n", RUNS);
+        time_literals("d.dddddd", &floats);
+        time_literals("26 digits", &long_floats);
+        time_literals("integers", &integers);
+    }
+
+    free(floats.data);
+    free(long_floats.data);
+    free(integers.data);
+}
+
+// =============== Driver ===============
+
+typedef struct {
+    const char* name;
+    void (*run)(bool emit);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+    { "symbols", bench_symbols },
+    { "lexer", bench_lexer },
+    { "flat", bench_flat },
+    { "parser", bench_parser },
+    { "literals", bench_literals },
+};
+
+#define BENCHMARKS_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static const benchmark_t* find_benchmark(const char* name) {
+    for(size_t i = 0; i < BENCHMARKS_COUNT; i++) {
+        if(strcmp(benchmarks[i].name, name) == 0) return &benchmarks[i];
+    }
+
+    fprintf(stderr, "bench: Unknown benchmark '%s'.\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    select_scan_kernels();
+    seed = 0x9e3779b97f4a7c15ull;
+
+    if(argc == 3 && strcmp(argv[1], "--emit") == 0) {
+        find_benchmark(argv[2])->run(true);
+        free_all();
+        return 0;
+    }
+
+    for(size_t i = 0; i < BENCHMARKS_COUNT; i++) {
+        bool selected = argc == 1;
+        for(int j = 1; j < argc; j++) {
+            selected = selected || find_benchmark(argv[j]) == &benchmarks[i];
+        }
+
+        if(selected) {
+            benchmarks[i].run(false);
+        }
+    }
+
+    free_all();
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include "memory.h"
 #include "lexer.h"
 #include "types.h"
+#include "symbol_table.h"
 
 #include <stdbool.h>
 
@@ -18,12 +19,18 @@ typedef enum {
     SUBSCRIPT_EXPR_NODE,    
     VARIABLE_EXPR_NODE,
     INITIALIZER_NODE,
-    LITERAL_NODE
+    LITERAL_NODE,
+
+    // Produced by the lowering, never by the parser.
+    ELEMENT_EXPR_NODE
 } ast_node_kind_t;
 
 typedef struct _ast_node {
     ast_node_kind_t kind;
     const struct _ast_node* next;
+
+    // Set by the typechecker on the expressions it could type, NULL otherwise.
+    const type_t* type;
 } ast_node_t;
 
 typedef struct {
@@ -35,6 +42,12 @@ typedef struct {
     const type_t* type;
 
     const ast_node_t* rvalue;
+
+    // Set by the typechecker.
+    uint32_t slot;
+
+    // Position in the data segment, set by `plan_layout`.
+    uint64_t offset;
 } variable_decl_t;
 
 typedef struct {
@@ -79,30 +92,80 @@ typedef struct {
     const type_t* target_type;
 } casting_expr_t;
 
+// What the bounds analysis proved about an array access.
+typedef enum {
+    BOUNDS_UNKNOWN,
+    BOUNDS_IN_RANGE,
+    BOUNDS_OUT_OF_RANGE
+} bounds_status_t;
+
 typedef struct {
     ast_node_t base;
 
     const ast_node_t* lvalue;
     const ast_node_t* index;
+
+    // Offset of the '[' in the source, diagnostics compute its line.
+    uint32_t offset;
+    bounds_status_t bounds;
 } subscript_expr_t;
 
 typedef struct {
     ast_node_t base;
     token_t name;
+
+    // Slot of the declaration the name refers to, set by the typechecker.
+    uint32_t slot;
 } variable_expr_t;
 
 typedef struct _initializer {
     ast_node_t base;
     const ast_node_t* init;
+
+    // Image of a constant bool array, one bit per element in row-major
+    // order, set by the lowering. NULL otherwise.
+    const uint8_t* bits;
+    uint64_t bit_count;
 } initializer_t;
 
+// Value of a literal, tagged by its type: floats hold `real`, in double
+// precision, integers and bools are exact in `integer`.
+typedef union _literal_value {
+    int64_t integer;
+    double real;
+} literal_value_t;
+
+#define INTEGER_VALUE(v) ((literal_value_t) { .integer = (v) })
+#define REAL_VALUE(v) ((literal_value_t) { .real = (v) })
+
 typedef struct {
     ast_node_t base;
 
     const type_t* type;
-    float value;
+    literal_value_t value;
 } literal_expr_t;
 
+// A chain of subscripts lowered into one access. `offset`, an `integer`,
+// counts values of the type of the node from the start of `array`, in
+// row-major order.
+typedef struct {
+    ast_node_t base;
+
+    const ast_node_t* array;
+    const ast_node_t* offset;
+
+    // Number of subscripts the node replaces.
+    int dimensions;
+
+    // In range only when every subscript of the chain is.
+    bounds_status_t bounds;
+
+    // Set when the array holds bools, stored one bit per element. The bool
+    // at bit `b` is read as `(bytes[b >> 3] >> (b & 7)) & 1` and written
+    // through the mask `1 << (b & 7)`, `b` being `offset` for a single bool.
+    bool is_packed;
+} element_expr_t;
+
 const ast_node_t* make_var_decl(token_t name, const type_t* type, 
                                 const ast_node_t* initializer);
 
@@ -115,11 +178,26 @@ const ast_node_t* make_assign_expr(const ast_node_t* lvalue, const ast_node_t* r
 const ast_node_t* make_binary_expr(token_t op, const ast_node_t* left, const ast_node_t* right);
 const ast_node_t* make_unary_expr(token_t op, const ast_node_t* right);
 const ast_node_t* make_casting_expr(const ast_node_t* expr, const type_t* target_type);
-const ast_node_t* make_subscript_expr(const ast_node_t* lvalue, const ast_node_t* index);
+const ast_node_t* make_subscript_expr(const ast_node_t* lvalue, const ast_node_t* index, uint32_t offset);
 const ast_node_t* make_variable_expr(token_t name);
 const ast_node_t* make_initializer(const ast_node_t* init);
-const ast_node_t* make_literal_expr(float value, const type_t* type);
+const ast_node_t* make_literal_expr(literal_value_t value, const type_t* type);
+const ast_node_t* make_element_expr(const ast_node_t* array, const ast_node_t* offset, int dimensions);
+
+// Called on each node once its children have been rewritten, returns the
+// node that takes its place in the parent.
+typedef const ast_node_t* (*ast_rewrite_fn)(const ast_node_t* node, void* context);
+
+// Rewrites the declarations of the program in post-order, without recursion.
+// A declaration rewritten to NULL is removed. Returns the new program.
+const ast_node_t* rewrite_ast(const ast_node_t* program, ast_rewrite_fn rewrite, void* context);
+
+// Nodes in the subtree of `node`, without the declarations following it.
+size_t count_ast_nodes(const ast_node_t* node);
 
 void print_ast(const ast_node_t* node);
 
+// The bytes of a packed image, lowest first, as printed after "packed".
+void print_packed_bits(const uint8_t* bits, uint64_t count);
+
 #endif
@@ -0,0 +1,30 @@
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+#include "ast.h"
+
+#include <stddef.h>
+
+typedef struct _bounds_stats {
+    // Subscripts analyzed.
+    size_t accesses;
+
+    // Subscripts whose index is always inside the array.
+    size_t in_range;
+
+    // Subscripts whose index is never inside the array, each one reported.
+    size_t out_of_range;
+} bounds_stats_t;
+
+// Computes the range of values of the integer expressions and marks each
+// subscript whose index is proven inside, or outside, the length of the
+// array. The ranges of the integer variables follow the program order, both
+// branches of an `if` are joined, and its condition narrows them when it
+// compares a variable. A branch the condition rules out is not checked and
+// adds nothing to the join. Overflows make a range unknown, or the whole range of
+// a narrower integer type. Relies on the types and slots recorded by a
+// successful `typecheck_ast`. Returns false when an access is out of range,
+// reported with its line in `source`.
+bool analyze_bounds(const ast_node_t* program, string_view_t source, bounds_stats_t* stats);
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _FLAT_AST_H_
+#define _FLAT_AST_H_
+
+#include "ast.h"
+
+#include <stdint.h>
+
+// Alternative representation of the AST: the nodes of each kind are stored
+// in their own contiguous array, children are 32-bit references and the
+// top-level declarations are a dense array instead of a `next` chain.
+
+// The kind of the node is kept in the top 4 bits, its index inside the
+// array of that kind in the remaining 28.
+typedef uint32_t node_ref_t;
+
+#define NODE_REF(kind, index) (((uint32_t)(kind) << 28) | (uint32_t)(index))
+#define NODE_REF_KIND(ref) ((ast_node_kind_t)((ref) >> 28))
+#define NODE_REF_INDEX(ref) ((ref) & 0x0FFFFFFF)
+
+#define NULL_NODE_REF ((node_ref_t)-1)
+
+typedef struct {
+    intern_id_t name;
+
+    bool is_type_inferred;
+    uint32_t type;
+
+    node_ref_t rvalue;
+} flat_variable_decl_t;
+
+typedef struct {
+    node_ref_t condition;
+    node_ref_t then;
+    node_ref_t otherwise;
+} flat_if_statement_t;
+
+typedef struct {
+    node_ref_t expr;
+} flat_expr_statement_t;
+
+typedef struct {
+    node_ref_t lvalue;
+    node_ref_t rvalue;
+} flat_assign_expr_t;
+
+typedef struct {
+    uint8_t op;
+    node_ref_t left;
+    node_ref_t right;
+} flat_binary_expr_t;
+
+typedef struct {
+    uint8_t op;
+    node_ref_t right;
+} flat_unary_expr_t;
+
+typedef struct {
+    node_ref_t expr;
+    uint32_t target_type;
+} flat_casting_expr_t;
+
+typedef struct {
+    node_ref_t lvalue;
+    node_ref_t index;
+
+    // A bounds_status_t.
+    uint8_t bounds;
+} flat_subscript_expr_t;
+
+typedef struct {
+    intern_id_t name;
+} flat_variable_expr_t;
+
+// The elements are a slice of `flat_ast_t.elements`.
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+
+    // Image of the constant bool array the lowering packed, NULL otherwise.
+    const uint8_t* bits;
+    uint64_t bit_count;
+} flat_initializer_t;
+
+typedef struct {
+    uint32_t type;
+    literal_value_t value;
+} flat_literal_expr_t;
+
+typedef struct {
+    node_ref_t array;
+    node_ref_t offset;
+    uint32_t dimensions;
+    uint8_t bounds;
+    bool is_packed;
+} flat_element_expr_t;
+
+#define FLAT_ARRAY(type) struct { type* items; uint32_t count; uint32_t capacity; }
+
+typedef struct _flat_ast {
+    FLAT_ARRAY(flat_variable_decl_t) variable_decls;
+    FLAT_ARRAY(flat_if_statement_t) if_statements;
+    FLAT_ARRAY(flat_expr_statement_t) expr_statements;
+    FLAT_ARRAY(flat_assign_expr_t) assign_exprs;
+    FLAT_ARRAY(flat_binary_expr_t) binary_exprs;
+    FLAT_ARRAY(flat_unary_expr_t) unary_exprs;
+    FLAT_ARRAY(flat_casting_expr_t) casting_exprs;
+    FLAT_ARRAY(flat_subscript_expr_t) subscript_exprs;
+    FLAT_ARRAY(flat_variable_expr_t) variable_exprs;
+    FLAT_ARRAY(flat_initializer_t) initializers;
+    FLAT_ARRAY(flat_literal_expr_t) literal_exprs;
+    FLAT_ARRAY(flat_element_expr_t) element_exprs;
+
+    FLAT_ARRAY(node_ref_t) elements;
+    FLAT_ARRAY(node_ref_t) decls;
+} flat_ast_t;
+
+flat_ast_t flatten_ast(const ast_node_t* program);
+
+// Bytes used by the node arrays.
+size_t flat_ast_size(const flat_ast_t* ast);
+
+void print_flat_ast(const flat_ast_t* ast);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include "string_view.h"
+
+#include <stdint.h>
+
+typedef uint32_t intern_id_t;
+
+#define INTERN_INVALID_ID ((intern_id_t)-1)
+
+// Returns the same id for every occurrence of the same name, ids are dense
+// and start from 0. The pool keeps its own copy of the characters.
+// Safe to call from several threads.
+intern_id_t intern(string_view_t name);
+
+// Not synchronized with concurrent calls to `intern`.
+string_view_t interned_name(intern_id_t id);
+size_t interned_count();
+
+#endif
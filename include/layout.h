@@ -0,0 +1,42 @@
+#ifndef _LAYOUT_H_
+#define _LAYOUT_H_
+
+#include "ast.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Alignment, and granularity of the size, of the data segment.
+#define LAYOUT_SEGMENT_ALIGNMENT 64
+
+typedef struct _layout_entry {
+    const variable_decl_t* decl;
+    const type_t* type;
+
+    uint64_t offset;
+    uint64_t size;
+    uint32_t alignment;
+} layout_entry_t;
+
+// Every variable of the program at a fixed offset of one data segment.
+typedef struct _data_layout {
+    // By increasing offset.
+    layout_entry_t* entries;
+    uint32_t count;
+
+    // Bytes of the segment, and bytes actually holding variables.
+    uint64_t size;
+    uint64_t used;
+} data_layout_t;
+
+// Places the variables by decreasing alignment, which leaves no padding
+// between them, then rounds the segment up to LAYOUT_SEGMENT_ALIGNMENT. Bool
+// arrays are packed, a bit per element. The offset is also stored in each
+// `variable_decl_t`. Relies on the types recorded by a successful
+// `typecheck_ast`, the entries come from the active arena. Returns false,
+// after reporting it, when a size doesn't fit 64 bits.
+bool plan_layout(const ast_node_t* program, data_layout_t* layout);
+
+void print_layout(const data_layout_t* layout);
+
+#endif
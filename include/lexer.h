@@ -2,6 +2,10 @@
 #define _LEXER_H_
 
 #include "string_view.h"
+#include "intern.h"
+
+#include <stdbool.h>
+#include <stdint.h>
 
 typedef enum _token_type {
     PLUS,
@@ -35,28 +39,72 @@ typedef enum _token_type {
     FLOAT_KEYWORD,
     INTEGER_KEYWORD,
     BOOL_KEYWORD,
+    I8_KEYWORD,
+    I16_KEYWORD,
+    I32_KEYWORD,
+    I64_KEYWORD,
+    F32_KEYWORD,
+    F64_KEYWORD,
     IDENTIFIER,
     TOK_EOF,
-    TOK_ERR
+    TOK_ERR,
+
+    // The token may continue past the end of a partial input.
+    TOK_SUSPEND
 } token_type_t;
 
+// The lexeme is not stored, only its position in the source. Line numbers
+// are computed from the offset when a diagnostic needs them.
 typedef struct _token {
-    token_type_t type;
+    uint32_t start;
+    uint32_t length;
+
+    // Interned name, only for IDENTIFIER tokens.
+    intern_id_t id;
 
-    int line;
-    string_view_t lexeme;
+    uint8_t type;
 } token_t;
 
+#define TOKEN_TEXT(source, token) (string_view_data(source) + (token).start)
+
+// The lexer reads the source up to a terminating '\0', which must follow
+// the last character of the view, and may read up to LEXER_PADDING bytes
+// past it.
+#define LEXER_PADDING 32
+
 typedef struct _lexer {
     string_view_t source;
 
-    int current;
-    int start;
-    int line;
+    uint32_t current;
+    uint32_t start;
+
+    // When false the source is only a prefix of the input, and any token
+    // reaching its end is returned as TOK_SUSPEND.
+    bool is_final;
 } lexer_t;
 
-#define INIT_LEXER(src) (lexer_t){ .source = (src), .current = 0, .start = 0, .line = 1}
+#define INIT_LEXER(src) (lexer_t){ .source = (src), .current = 0, .start = 0, .is_final = true}
 
 token_t next_token(lexer_t* lex);
 
+// Spelling of operators and keywords, NULL for the other tokens.
+const char* token_spelling(token_type_t type);
+
+// Whole source lexed up front, stored as a structure of arrays. The last
+// token is always TOK_EOF or TOK_ERR.
+typedef struct _token_buffer {
+    string_view_t source;
+
+    uint8_t* types;
+    uint32_t* starts;
+    uint32_t* lengths;
+    intern_id_t* ids;
+
+    size_t count;
+    size_t capacity;
+} token_buffer_t;
+
+token_buffer_t tokenize(string_view_t source);
+token_t token_buffer_get(const token_buffer_t* tokens, size_t index);
+
 #endif
@@ -0,0 +1,19 @@
+#ifndef _LITERAL_H_
+#define _LITERAL_H_
+
+#include "string_view.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Values of the numeric literals, read from their lexemes without going
+// past them, nor through the locale.
+
+// Decimal digits only. Returns false when the value doesn't fit an int64_t.
+bool parse_integer_literal(string_view_t lexeme, int64_t* value);
+
+// Digits, '.', digits. The value is rounded once, to the nearest float.
+// Returns false when it's too large for a float.
+bool parse_float_literal(string_view_t lexeme, float* value);
+
+#endif
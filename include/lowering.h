@@ -0,0 +1,31 @@
+#ifndef _LOWERING_H_
+#define _LOWERING_H_
+
+#include "ast.h"
+
+#include <stddef.h>
+
+typedef struct _lowering_stats {
+    // Subscripts merged into element accesses.
+    size_t subscripts;
+
+    // Element accesses left in the program, one per chain of subscripts.
+    size_t accesses;
+
+    // Accesses to bool arrays, which address single bits.
+    size_t packed;
+
+    // Constant bool array initializers given a packed image.
+    size_t packed_initializers;
+} lowering_stats_t;
+
+// Replaces each chain of subscripts with one `element_expr_t`. The offset is
+// computed in row-major order from the lengths of the array type, with a
+// multiply-add per subscript, folded where the indices are literals. The
+// access keeps what `analyze_bounds` proved about the chain. Bool arrays
+// are packed: their accesses address bits, and their constant initializers
+// get a bitset image. Relies on the types recorded by a successful
+// `typecheck_ast`.
+const ast_node_t* lower_ast(const ast_node_t* program, lowering_stats_t* stats);
+
+#endif
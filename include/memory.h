@@ -3,9 +3,50 @@
 
 #include <stddef.h>
 
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT (_Alignof(max_align_t))
+
+typedef struct _arena_chunk {
+    struct _arena_chunk* prev;
+
+    size_t capacity;
+    size_t used;
+
+    max_align_t data[];
+} arena_chunk_t;
+
+typedef struct _arena {
+    arena_chunk_t* current;
+    size_t chunk_size;
+} arena_t;
+
+// Position inside an arena, everything allocated after it can be released
+// at once with `arena_rollback`.
+typedef struct _arena_mark {
+    arena_chunk_t* chunk;
+    size_t used;
+} arena_mark_t;
+
+arena_t* create_arena(size_t chunk_size);
+void* arena_allocate(arena_t* arena, size_t size);
+void arena_reset(arena_t* arena);
+
+arena_mark_t arena_mark(const arena_t* arena);
+void arena_rollback(arena_t* arena, arena_mark_t mark);
+void destroy_arena(arena_t* arena);
+
+// Moves the memory of `src` into `dst`, as if it had been allocated after
+// the current position of `dst`, then frees `src`.
+void arena_merge(arena_t* dst, arena_t* src);
+
+// Select the arena used by `allocate` in this thread, returns the previous one.
+arena_t* use_arena(arena_t* arena);
+arena_t* active_arena();
+
 void* allocate(size_t size);
 void free_all();
 
 #define MALLOC(type, size) (type)allocate((size))
+#define ARENA_MALLOC(arena, type, size) (type)arena_allocate((arena), (size))
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef _OPTIMIZER_H_
+#define _OPTIMIZER_H_
+
+#include "ast.h"
+
+#include <stddef.h>
+
+typedef struct _optimizer_stats {
+    // Expressions replaced by a literal.
+    size_t folded;
+
+    // `if` statements replaced by the branch their constant condition selects.
+    size_t dead_branches;
+
+    // Nodes no longer reachable from the program.
+    size_t removed;
+} optimizer_stats_t;
+
+// Folds the arithmetic, comparisons and casts whose operands are literals,
+// and drops the branches of `if` statements that can't be taken. Relies on
+// the types recorded by a successful `typecheck_ast`. The tree is rewritten
+// in place, new nodes come from the active arena. Returns the program, whose
+// first declaration may have been removed.
+const ast_node_t* optimize_ast(const ast_node_t* program, optimizer_stats_t* stats);
+
+#endif
@@ -4,13 +4,88 @@
 #include "lexer.h"
 #include "ast.h"
 
+#include <setjmp.h>
+
 typedef struct _parser {
     lexer_t lexer;
+
+    // When not NULL tokens are read from here instead of the lexer.
+    const token_buffer_t* tokens;
+    size_t position;
+
     token_t curr;
     token_t prev;
+
+    // Line number of the first byte of the source.
+    int first_line;
+
+    // Where to jump on a syntax error instead of reporting it and exiting.
+    jmp_buf* on_error;
+
+    // Constructs waiting for a nested one, grown as needed.
+    struct _parse_frame* frames;
+    uint32_t frames_count;
+    uint32_t frames_capacity;
 } parser_t;
 
 parser_t init_parser(string_view_t source);
+parser_t init_parser_from_tokens(const token_buffer_t* tokens);
+void destroy_parser(parser_t* p);
 const ast_node_t* parse_program(parser_t* p);
 
+// Same result as `parse_program`, with the source split at top-level
+// declarations which are parsed on up to `jobs` threads. The nodes end up in
+// the active arena. `source` must be terminated like for `init_parser`.
+const ast_node_t* parse_program_parallel(string_view_t source, int jobs);
+
+// Parses declarations out of input pushed in chunks. The input is lexed as
+// it arrives, a declaration is parsed once all its tokens are there, then
+// its bytes are dropped from the buffer, which never holds much more than
+// the declaration being read.
+typedef struct _stream_parser {
+    parser_t parser;
+
+    char* buffer;
+    size_t size;
+    size_t capacity;
+
+    // Start of the next declaration inside the buffer.
+    size_t consumed;
+
+    // Tokens of the next declaration lexed so far, with offsets into the
+    // buffer. Not in the arena, since partial attempts are rolled back.
+    token_buffer_t tokens;
+
+    // Where lexing resumes inside the buffer.
+    size_t lexed;
+
+    // The tokens before `checked` are known not to end the declaration,
+    // they leave `depth` braces open and may end with a top-level `;`.
+    size_t checked;
+    int depth;
+    bool after_semicolon;
+
+    // Declarations returned so far.
+    size_t count;
+
+    // Nothing is dropped from the buffer, the offsets kept in the nodes
+    // stay valid in it.
+    bool keeps_input;
+
+    bool is_closed;
+    bool is_done;
+} stream_parser_t;
+
+stream_parser_t create_stream_parser();
+void destroy_stream_parser(stream_parser_t* sp);
+
+void stream_parser_push(stream_parser_t* sp, const char* data, size_t size);
+
+// Marks the end of the input.
+void stream_parser_close(stream_parser_t* sp);
+
+// Returns NULL when more input is needed, or when the input is over
+// (`is_done`).
+const ast_node_t* stream_parser_next(stream_parser_t* sp);
+
 #endif
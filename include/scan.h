@@ -0,0 +1,27 @@
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+// Vectorized scanning kernels used by the lexer. The input must be terminated
+// by '\0' followed by LEXER_PADDING readable bytes, since the kernels load up
+// to 32 bytes at a time and only stop at the sentinel.
+
+typedef struct _scan_kernels {
+    // Skips ' ', '\t', '\r' and '\n'.
+    const char* (*skip_blanks)(const char* p);
+
+    // Returns the first '\n' or '\0'.
+    const char* (*find_line_end)(const char* p);
+
+    // Skips letters and digits.
+    const char* (*skip_alnum)(const char* p);
+    const char* (*skip_digits)(const char* p);
+} scan_kernels_t;
+
+// The scalar kernels until select_scan_kernels() is called.
+extern scan_kernels_t scan;
+
+// Picks the best kernels for the running CPU. It writes `scan`, so it must be
+// called before any thread that lexes is started.
+void select_scan_kernels();
+
+#endif
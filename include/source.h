@@ -0,0 +1,47 @@
+#ifndef _SOURCE_H_
+#define _SOURCE_H_
+
+#include "string_view.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Program text ready for the lexer: terminated by '\0' and followed by
+// LEXER_PADDING readable bytes. Regular files are mapped read-only without
+// copying, anything else (pipes, terminals) is read into a buffer.
+typedef struct _source_file {
+    string_view_t text;
+
+    void* data;
+    size_t capacity;
+    bool is_mapped;
+} source_file_t;
+
+// Exits with an error message when the file can't be read. With `populate`
+// the whole mapping is faulted in up front.
+source_file_t open_source_file(const char* path, bool populate);
+void close_source_file(source_file_t* file);
+
+// Unbuffered input read piece by piece, for the streaming parser.
+typedef struct _source_stream {
+    const char* path;
+    int fd;
+} source_stream_t;
+
+source_stream_t open_source_stream(const char* path);
+
+// Reads at most `size` bytes as soon as they are available, returns 0 at the end of the input.
+size_t source_stream_read(source_stream_t* stream, char* buffer, size_t size);
+void close_source_stream(source_stream_t* stream);
+
+typedef struct _source_location {
+    int line;
+    int column;
+} source_location_t;
+
+// Line and column (both starting from 1) of a byte offset. The newline index
+// is built the first time a location inside `source` is requested.
+source_location_t source_location(string_view_t source, uint32_t offset);
+
+#endif
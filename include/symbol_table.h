@@ -2,22 +2,42 @@
 #define _SYMBOL_TABLE_H_
 
 #include "types.h"
-#include "string_view.h"
+#include "intern.h"
+#include "memory.h"
 
-typedef struct _symbol_entry {
-    string_view_t name;
+#define SYMBOL_TABLE_INITIAL_CAPACITY 64
+
+#define SYMBOL_NO_SLOT ((uint32_t)-1)
+
+typedef struct _symbol {
     const type_t* type;
 
-    struct _symbol_entry* next;
-} symbol_entry_t;
+    // Dense index of the declaration, in the order they are checked.
+    // SYMBOL_NO_SLOT for unbound and predefined names.
+    uint32_t slot;
+} symbol_t;
 
+// Indexed by the interned id of the name, unbound ids map to a NULL type. The
+// table lives in its own arena, so it survives rollbacks of the active one.
 typedef struct _symbol_table {
-    symbol_entry_t* start;
-    symbol_entry_t* end;
+    arena_t* arena;
+
+    symbol_t* symbols;
+    size_t capacity;
+
+    // Slots handed out so far.
+    uint32_t slot_count;
 } symbol_table_t;
 
 symbol_table_t* create_symbol_table();
-void symbol_table_put(symbol_table_t* symtbl, string_view_t name, const type_t* type);
-const type_t* symbol_table_search(symbol_table_t* symtbl, string_view_t name);
+void destroy_symbol_table(symbol_table_t* symtbl);
+
+// A redeclaration shadows the previous binding, which is returned (NULL for new names).
+const type_t* symbol_table_put(symbol_table_t* symtbl, intern_id_t name, const type_t* type);
+
+// Binds `name` like `symbol_table_put`, to a new slot which is returned.
+uint32_t symbol_table_declare(symbol_table_t* symtbl, intern_id_t name, const type_t* type);
+
+symbol_t symbol_table_search(symbol_table_t* symtbl, intern_id_t name);
 
 #endif
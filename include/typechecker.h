@@ -3,18 +3,28 @@
 
 #include "symbol_table.h"
 #include "ast.h"
+#include "flat_ast.h"
 
 #include <setjmp.h>
 #include <stdbool.h>
 
 typedef struct _typechecker {
     symbol_table_t* const symtbl;
+
+    // Short-lived allocations, released after each top-level declaration.
+    arena_t* const scratch;
     
     const type_t* current;
     bool had_error;
 } typechecker_t;
 
 typechecker_t create_typechecker();
+void destroy_typechecker(typechecker_t* tcheck);
 bool typecheck_ast(const ast_node_t* ast, typechecker_t* tcheck);
 
+// Checks a single top-level declaration, ignoring its `next`, against the
+// bindings left by the previous ones. Nothing refers to the node afterwards.
+bool typecheck_decl(const ast_node_t* decl, typechecker_t* tcheck);
+bool typecheck_flat_ast(const flat_ast_t* ast, typechecker_t* tcheck);
+
 #endif
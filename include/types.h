@@ -2,6 +2,8 @@
 #define _TYPES_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 typedef enum _type_kind {
     TYPE_INT,
@@ -10,8 +12,14 @@ typedef enum _type_kind {
     TYPE_ARRAY,
 } type_kind_t;
 
+// Types are hash-consed: structurally equal types are the same object and
+// share the same id, so they can be compared by pointer.
 typedef struct _type {
     type_kind_t kind;
+    uint32_t id;
+
+    // Bytes of a scalar value, integers and floats come in several widths.
+    uint32_t size;
 
     // For array data type
     int length;
@@ -19,17 +27,44 @@ typedef struct _type {
 } type_t;
 
 #define IS_ARRAY(t) ((t)->kind == TYPE_ARRAY)
+#define IS_INTEGER_TYPE(t) ((t)->kind == TYPE_INT)
+#define IS_FLOAT_TYPE(t) ((t)->kind == TYPE_FLOAT)
 #define IS_NUMERIC_TYPE(t) ((t)->kind == TYPE_INT || (t)->kind == TYPE_FLOAT)
 
+// `integer` is spelled `i64` too, and `float` is `f32`.
 extern type_t* float_type;
 extern type_t* int_type;
 extern type_t* bool_type;
 
-type_t* create_array_type(const type_t* underlying, int length);
+extern type_t* i8_type;
+extern type_t* i16_type;
+extern type_t* i32_type;
+extern type_t* f64_type;
+
+// The primitive types have the ids below this one.
+#define PRIMITIVE_TYPES_COUNT 7
+
+// Safe to call from several threads.
+const type_t* create_array_type(const type_t* underlying, int length);
+
+// Not synchronized with concurrent calls to `create_array_type`.
+const type_t* type_from_id(uint32_t id);
+size_t types_count();
+
+static inline bool are_types_equal(const type_t* t1, const type_t* t2) {
+    return t1 == t2;
+}
+
+// Values of an integer type, narrower ones wrap around.
+static inline void integer_type_range(const type_t* t, int64_t* low, int64_t* high) {
+    *high = t->size < 8 ? (INT64_C(1) << (t->size * 8 - 1)) - 1 : INT64_MAX;
+    *low = -*high - 1;
+}
 
-bool are_types_equal(const type_t* t1, const type_t* t2);
 bool can_cast_to(const type_t* from, const type_t* to);
 
+// Common type of the operands of a binary expression: the wider one of two
+// integers or two floats, the float one when they are mixed.
 const type_t* cast_to_bigger(const type_t* t1, const type_t* t2);
 
 void print_type(const type_t* restrict t);
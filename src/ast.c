@@ -1,7 +1,9 @@
 #include "../include/ast.h"
 #include "../include/memory.h"
 
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 inline const ast_node_t* make_var_decl(token_t name, const type_t* type, const ast_node_t* initializer) {
     variable_decl_t* const node = MALLOC(variable_decl_t*, sizeof(variable_decl_t));
@@ -12,6 +14,8 @@ inline const ast_node_t* make_var_decl(token_t name, const type_t* type, const a
     node->type = type;
     node->rvalue = initializer;
     node->is_type_inferred = (type == NULL);
+    node->slot = SYMBOL_NO_SLOT;
+    node->offset = 0;
 
     return (ast_node_t*)node;
 }
@@ -84,12 +88,14 @@ const ast_node_t* make_casting_expr(const ast_node_t* expr, const type_t* target
     return (ast_node_t*) node;
 }
 
-inline const ast_node_t* make_subscript_expr(const ast_node_t* lvalue, const ast_node_t* index) {
+inline const ast_node_t* make_subscript_expr(const ast_node_t* lvalue, const ast_node_t* index, uint32_t offset) {
     subscript_expr_t* const node = MALLOC(subscript_expr_t*, sizeof(subscript_expr_t));
 
     node->base.kind = SUBSCRIPT_EXPR_NODE;
     node->index = index;
     node->lvalue = lvalue;
+    node->offset = offset;
+    node->bounds = BOUNDS_UNKNOWN;
 
     return (ast_node_t*)node;
 }
@@ -99,6 +105,7 @@ inline const ast_node_t* make_variable_expr(token_t name) {
  
     node->base.kind = VARIABLE_EXPR_NODE;
     node->name = name;
+    node->slot = SYMBOL_NO_SLOT;
 
     return (ast_node_t*) node;
 }
@@ -108,11 +115,13 @@ inline const ast_node_t* make_initializer(const ast_node_t* init) {
 
     node->base.kind = INITIALIZER_NODE;
     node->init = init;
+    node->bits = NULL;
+    node->bit_count = 0;
 
     return (ast_node_t*) node;
 }
 
-inline const ast_node_t* make_literal_expr(float value, const type_t* type) {
+inline const ast_node_t* make_literal_expr(literal_value_t value, const type_t* type) {
     literal_expr_t* const node = MALLOC(literal_expr_t*, sizeof(literal_expr_t));
 
     node->base.kind = LITERAL_NODE;
@@ -122,17 +131,225 @@ inline const ast_node_t* make_literal_expr(float value, const type_t* type) {
     return (ast_node_t*)node;
 }
 
+inline const ast_node_t* make_element_expr(const ast_node_t* array, const ast_node_t* offset, int dimensions) {
+    element_expr_t* const node = MALLOC(element_expr_t*, sizeof(element_expr_t));
+
+    node->base.kind = ELEMENT_EXPR_NODE;
+    node->array = array;
+    node->offset = offset;
+    node->dimensions = dimensions;
+    node->bounds = BOUNDS_UNKNOWN;
+    node->is_packed = false;
+
+    return (ast_node_t*)node;
+}
+
+// =============== Rewriting ===============
+
+// Each frame holds the field of the parent that refers to the node, so that
+// the node can be replaced.
+typedef struct {
+    const ast_node_t** slot;
+    bool is_expanded;
+} rewrite_frame_t;
+
+typedef struct {
+    rewrite_frame_t* items;
+    size_t count;
+    size_t capacity;
+} rewrite_stack_t;
+
+static void push_slot(rewrite_stack_t* stack, const ast_node_t** slot) {
+    if(*slot == NULL) return;
+
+    if(stack->count == stack->capacity) {
+        stack->capacity = stack->capacity != 0 ? stack->capacity * 2 : 64;
+        stack->items = realloc(stack->items, sizeof(rewrite_frame_t) * stack->capacity);
+
+        if(stack->items == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    stack->items[stack->count++] = (rewrite_frame_t) {
+        .slot = slot,
+        .is_expanded = false
+    };
+}
+
+static void push_child_slots(rewrite_stack_t* stack, const ast_node_t* node) {
+    switch(node->kind) {
+        case VARIABLE_DECL_NODE:
+            push_slot(stack, &((variable_decl_t*)node)->rvalue);
+            break;
+        case IF_STATEMENT_NODE: {
+            if_statement_t* const stmt = (if_statement_t*)node;
+
+            push_slot(stack, &stmt->condition);
+            push_slot(stack, &stmt->then);
+            push_slot(stack, &stmt->otherwise);
+            break;
+        }
+        case EXPR_STATEMENT_NODE:
+            push_slot(stack, &((expr_statement_t*)node)->expr);
+            break;
+        case ASSIGN_EXPR_NODE:
+            push_slot(stack, &((assign_expr_t*)node)->lvalue);
+            push_slot(stack, &((assign_expr_t*)node)->rvalue);
+            break;
+        case BINARY_EXPR_NODE:
+            push_slot(stack, &((binary_expr_t*)node)->left);
+            push_slot(stack, &((binary_expr_t*)node)->right);
+            break;
+        case UNARY_EXPR_NODE:
+            push_slot(stack, &((unary_expr_t*)node)->right);
+            break;
+        case CASTING_EXPR_NODE:
+            push_slot(stack, &((casting_expr_t*)node)->expr);
+            break;
+        case SUBSCRIPT_EXPR_NODE:
+            push_slot(stack, &((subscript_expr_t*)node)->lvalue);
+            push_slot(stack, &((subscript_expr_t*)node)->index);
+            break;
+        case ELEMENT_EXPR_NODE:
+            push_slot(stack, &((element_expr_t*)node)->array);
+            push_slot(stack, &((element_expr_t*)node)->offset);
+            break;
+        case INITIALIZER_NODE:
+            // A replaced element takes over the `next` of the old one.
+            for(const ast_node_t** it = &((initializer_t*)node)->init; *it != NULL;
+                it = &((ast_node_t*)*it)->next) {
+                push_slot(stack, it);
+            }
+            break;
+        case VARIABLE_EXPR_NODE:
+        case LITERAL_NODE:
+            break;
+    }
+}
+
+static const ast_node_t* rewrite_node(const ast_node_t* root, ast_rewrite_fn rewrite, void* context,
+                                      rewrite_stack_t* stack) {
+    const ast_node_t* result = root;
+
+    push_slot(stack, &result);
+
+    while(stack->count > 0) {
+        rewrite_frame_t* const frame = &stack->items[stack->count - 1];
+
+        if(!frame->is_expanded) {
+            frame->is_expanded = true;
+            push_child_slots(stack, *frame->slot);
+            continue;
+        }
+
+        const ast_node_t** const slot = frame->slot;
+        stack->count--;
+
+        const ast_node_t* const replacement = rewrite(*slot, context);
+        if(replacement != *slot && replacement != NULL) {
+            ((ast_node_t*)replacement)->next = (*slot)->next;
+        }
+
+        *slot = replacement;
+    }
+
+    return result;
+}
+
+const ast_node_t* rewrite_ast(const ast_node_t* program, ast_rewrite_fn rewrite, void* context) {
+    rewrite_stack_t stack = {0};
+
+    const ast_node_t* head = NULL;
+    ast_node_t* last = NULL;
+
+    for(const ast_node_t* it = program; it != NULL; it = it->next) {
+        const ast_node_t* const decl = rewrite_node(it, rewrite, context, &stack);
+        if(decl == NULL) continue;
+
+        if(last != NULL) {
+            last->next = decl;
+        } else {
+            head = decl;
+        }
+
+        last = (ast_node_t*)decl;
+    }
+
+    if(last != NULL) {
+        last->next = NULL;
+    }
+
+    free(stack.items);
+    return head;
+}
+
+size_t count_ast_nodes(const ast_node_t* node) {
+    rewrite_stack_t stack = {0};
+    size_t count = 0;
+
+    push_slot(&stack, &node);
+
+    while(stack.count > 0) {
+        const ast_node_t* const it = *stack.items[--stack.count].slot;
+
+        push_child_slots(&stack, it);
+        count++;
+    }
+
+    free(stack.items);
+    return count;
+}
+
 // =============== AST Printer ===============
 
+// Nodes are printed in pre-order with an explicit stack, so deeply nested
+// expressions don't exhaust the call stack.
+typedef struct {
+    const ast_node_t* node;
+    int level;
+} print_frame_t;
+
+typedef struct {
+    print_frame_t* items;
+    size_t count;
+    size_t capacity;
+} print_stack_t;
+
+static void push_child(print_stack_t* stack, const ast_node_t* node, int level) {
+    if(node == NULL) return;
+
+    if(stack->count == stack->capacity) {
+        stack->capacity = stack->capacity != 0 ? stack->capacity * 2 : 64;
+        stack->items = realloc(stack->items, sizeof(print_frame_t) * stack->capacity);
+
+        if(stack->items == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    stack->items[stack->count++] = (print_frame_t) {
+        .node = node,
+        .level = level
+    };
+}
+
+// Accesses are annotated only once the bounds analysis proved something.
+static const char* const bounds_names[] = {
+    [BOUNDS_UNKNOWN] = "",
+    [BOUNDS_IN_RANGE] = "in range",
+    [BOUNDS_OUT_OF_RANGE] = "out of range"
+};
+
 static inline void print_tab(const int level) {
     for(int i = 0; i < level; i++) {
         printf("  ");
     }
 }
 
-static void print_ast_node(const ast_node_t* node, int level) {
-    
-    if(node == NULL) return;
+static void print_ast_node(const ast_node_t* node, int level, print_stack_t* stack) {
 
     putchar('\n');
     print_tab(level);
@@ -142,12 +359,12 @@ static void print_ast_node(const ast_node_t* node, int level) {
 
             const variable_decl_t* const decl = (variable_decl_t*)node;
 
-            printf("variable_decl: "STRING_VIEW_FORMAT" ", STRING_VIEW_ARG(decl->name.lexeme));
+            printf("variable_decl: "STRING_VIEW_FORMAT" ", STRING_VIEW_ARG(interned_name(decl->name.id)));
             if(!decl->is_type_inferred) {
                 print_type(decl->type);
             }
 
-            print_ast_node(decl->rvalue, level+1);
+            push_child(stack, decl->rvalue, level+1);
             break;
         }
         case IF_STATEMENT_NODE: {
@@ -155,9 +372,9 @@ static void print_ast_node(const ast_node_t* node, int level) {
             const if_statement_t* const stmt = (if_statement_t*)node;
 
             printf("if_statement: ");
-            print_ast_node(stmt->condition, level+1);
-            print_ast_node(stmt->then, level+1);
-            print_ast_node(stmt->otherwise, level+1);
+            push_child(stack, stmt->condition, level+1);
+            push_child(stack, stmt->then, level+1);
+            push_child(stack, stmt->otherwise, level+1);
 
             break;
         }
@@ -166,7 +383,7 @@ static void print_ast_node(const ast_node_t* node, int level) {
              const expr_statement_t* const stmt = (expr_statement_t*)node;
 
              printf("expr_statement: ");
-             print_ast_node(stmt->expr, level+1);
+             push_child(stack, stmt->expr, level+1);
              break;
          }
          case ASSIGN_EXPR_NODE: {
@@ -174,8 +391,8 @@ static void print_ast_node(const ast_node_t* node, int level) {
              const assign_expr_t* const expr = (assign_expr_t*)node;
 
              printf("assign_expr: ");
-             print_ast_node(expr->lvalue, level+1);
-             print_ast_node(expr->rvalue, level+1);
+             push_child(stack, expr->lvalue, level+1);
+             push_child(stack, expr->rvalue, level+1);
 
              break;
          }
@@ -183,9 +400,9 @@ static void print_ast_node(const ast_node_t* node, int level) {
 
              const binary_expr_t* const expr = (binary_expr_t*)node;
 
-             printf("binary_expr: "STRING_VIEW_FORMAT, STRING_VIEW_ARG(expr->op.lexeme));
-             print_ast_node(expr->left, level+1);
-             print_ast_node(expr->right, level+1);
+             printf("binary_expr: %s", token_spelling(expr->op.type));
+             push_child(stack, expr->left, level+1);
+             push_child(stack, expr->right, level+1);
 
              break;
          }
@@ -193,8 +410,8 @@ static void print_ast_node(const ast_node_t* node, int level) {
 
              const unary_expr_t* const expr = (unary_expr_t*)node;
 
-             printf("unary_expr: "STRING_VIEW_FORMAT, STRING_VIEW_ARG(expr->op.lexeme));
-             print_ast_node(expr->right, level+1);
+             printf("unary_expr: %s", token_spelling(expr->op.type));
+             push_child(stack, expr->right, level+1);
 
              break;
          }
@@ -204,7 +421,7 @@ static void print_ast_node(const ast_node_t* node, int level) {
 
              printf("casting_expr: ");
              print_type(expr->target_type);
-             print_ast_node(expr->expr, level + 1);
+             push_child(stack, expr->expr, level+1);
 
              break;
          }
@@ -212,9 +429,9 @@ static void print_ast_node(const ast_node_t* node, int level) {
 
              const subscript_expr_t* const expr = (subscript_expr_t*)node;
 
-             printf("subscript_expr: ");
-             print_ast_node(expr->lvalue, level+1);
-             print_ast_node(expr->index, level+1);
+             printf("subscript_expr: %s", bounds_names[expr->bounds]);
+             push_child(stack, expr->lvalue, level+1);
+             push_child(stack, expr->index, level+1);
 
              break;
          }
@@ -223,7 +440,7 @@ static void print_ast_node(const ast_node_t* node, int level) {
              const variable_expr_t* const var = (variable_expr_t*)node;
 
              printf("variable_expr: "STRING_VIEW_FORMAT, 
-                    STRING_VIEW_ARG(var->name.lexeme));
+                    STRING_VIEW_ARG(interned_name(var->name.id)));
 
              break;
          }
@@ -232,17 +449,36 @@ static void print_ast_node(const ast_node_t* node, int level) {
              const initializer_t* const list = (initializer_t*)node;
 
              printf("initializer: ");
+             if(list->bits != NULL) {
+                 print_packed_bits(list->bits, list->bit_count);
+             }
+
              for(const ast_node_t* it = list->init; it != NULL; it = it->next) {
-                 print_ast_node(it, level+1);
+                 push_child(stack, it, level+1);
              }
 
              break;
          }
+         case ELEMENT_EXPR_NODE: {
+
+             const element_expr_t* const expr = (element_expr_t*)node;
+
+             printf("element_expr: %s%s", expr->is_packed ? "packed " : "", bounds_names[expr->bounds]);
+             push_child(stack, expr->array, level+1);
+             push_child(stack, expr->offset, level+1);
+
+             break;
+         }
          case LITERAL_NODE: {
 
              const literal_expr_t* const lit = (literal_expr_t*)node;
 
-             printf("literal_expr: %g (", lit->value);
+             if(IS_FLOAT_TYPE(lit->type)) {
+                 printf("literal_expr: %g (", lit->value.real);
+             } else {
+                 printf("literal_expr: %" PRId64 " (", lit->value.integer);
+             }
+
              print_type(lit->type);
              putchar(')');
 
@@ -251,8 +487,34 @@ static void print_ast_node(const ast_node_t* node, int level) {
     }
 }
 
+void print_packed_bits(const uint8_t* bits, uint64_t count) {
+    printf("packed");
+
+    for(uint64_t i = 0; i < (count + 7) / 8; i++) {
+        printf(" %02x", bits[i]);
+    }
+}
+
 void print_ast(const ast_node_t* node) {
+    print_stack_t stack = {0};
+
     for(const ast_node_t* it = node; it != NULL; it = it->next){
-        print_ast_node(it, 0);
+        push_child(&stack, it, 0);
+
+        while(stack.count > 0) {
+            const print_frame_t frame = stack.items[--stack.count];
+            const size_t first = stack.count;
+
+            print_ast_node(frame.node, frame.level, &stack);
+
+            // The children were pushed in order, they have to be popped in order.
+            for(size_t lo = first, hi = stack.count; lo + 1 < hi; lo++, hi--) {
+                const print_frame_t tmp = stack.items[lo];
+                stack.items[lo] = stack.items[hi - 1];
+                stack.items[hi - 1] = tmp;
+            }
+        }
     }
+
+    free(stack.items);
 }
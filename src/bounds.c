@@ -0,0 +1,717 @@
+#include "../include/bounds.h"
+#include "../include/memory.h"
+#include "../include/source.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SCRATCH_CHUNK_SIZE (16 * 1024)
+#define INITIAL_CAPACITY 64
+
+// =============== Intervals ===============
+
+// Every value from `low` to `high`. Nothing is known of a value whose range
+// is the whole int64_t range.
+typedef struct {
+    int64_t low;
+    int64_t high;
+} interval_t;
+
+#define UNKNOWN_RANGE ((interval_t) { .low = INT64_MIN, .high = INT64_MAX })
+
+static inline interval_t make_interval(int64_t low, int64_t high) {
+    return (interval_t) { .low = low, .high = high };
+}
+
+static inline int64_t min_of(const int64_t values[4]) {
+    int64_t result = values[0];
+    for(int i = 1; i < 4; i++) {
+        if(values[i] < result) result = values[i];
+    }
+
+    return result;
+}
+
+static inline int64_t max_of(const int64_t values[4]) {
+    int64_t result = values[0];
+    for(int i = 1; i < 4; i++) {
+        if(values[i] > result) result = values[i];
+    }
+
+    return result;
+}
+
+static inline interval_t join_intervals(interval_t a, interval_t b) {
+    return make_interval(a.low < b.low ? a.low : b.low, a.high > b.high ? a.high : b.high);
+}
+
+// The bounds of a product or quotient are reached at the corners.
+static interval_t arithmetic_interval(token_type_t op, interval_t a, interval_t b) {
+    int64_t low, high;
+
+    switch(op) {
+        case PLUS:
+            if(__builtin_add_overflow(a.low, b.low, &low)) return UNKNOWN_RANGE;
+            if(__builtin_add_overflow(a.high, b.high, &high)) return UNKNOWN_RANGE;
+            return make_interval(low, high);
+        case MINUS:
+            if(__builtin_sub_overflow(a.low, b.high, &low)) return UNKNOWN_RANGE;
+            if(__builtin_sub_overflow(a.high, b.low, &high)) return UNKNOWN_RANGE;
+            return make_interval(low, high);
+        case STAR: {
+            int64_t corners[4];
+            if(__builtin_mul_overflow(a.low, b.low, &corners[0]) ||
+               __builtin_mul_overflow(a.low, b.high, &corners[1]) ||
+               __builtin_mul_overflow(a.high, b.low, &corners[2]) ||
+               __builtin_mul_overflow(a.high, b.high, &corners[3])) {
+                return UNKNOWN_RANGE;
+            }
+
+            return make_interval(min_of(corners), max_of(corners));
+        }
+        case SLASH: {
+            // Truncating division is monotonic as long as the divisor keeps its sign.
+            if(b.low <= 0 && b.high >= 0) return UNKNOWN_RANGE;
+            if((a.low == INT64_MIN) && (b.low == -1 || b.high == -1)) return UNKNOWN_RANGE;
+
+            const int64_t corners[4] = {
+                a.low / b.low, a.low / b.high,
+                a.high / b.low, a.high / b.high
+            };
+
+            return make_interval(min_of(corners), max_of(corners));
+        }
+        default:
+            return UNKNOWN_RANGE;
+    }
+}
+
+// =============== Analyzer ===============
+
+typedef struct {
+    interval_t value;
+
+    // Value at the end of the else branch of the `if` being joined.
+    interval_t else_value;
+
+    // Stamps of the branches that assigned the variable.
+    uint32_t then_stamp;
+    uint32_t else_stamp;
+} slot_state_t;
+
+// Previous value of a variable, restored when leaving a branch.
+typedef struct {
+    uint32_t slot;
+    interval_t value;
+} trail_entry_t;
+
+// Nodes are analyzed in post-order without recursion, like the typechecker.
+// The range of the last expression is in `analyzer->current`.
+typedef struct {
+    const ast_node_t* node;
+
+    // Next element of an initializer.
+    const ast_node_t* it;
+
+    // Range of the left operand, or of the sides of a condition.
+    interval_t saved;
+    interval_t other;
+
+    // Trail length and assignments counted when the `if` began, and where the
+    // variables assigned in its then branch start in `branch`.
+    uint32_t mark;
+    uint32_t branch;
+    uint32_t branch_count;
+    size_t assignments;
+
+    bool is_narrowing;
+
+    // Whether the `if` itself, and its then branch, can be reached.
+    bool was_reachable;
+    bool then_reachable;
+
+    uint8_t stage;
+} bounds_frame_t;
+
+#define ARRAY(type) struct { type* items; uint32_t count; uint32_t capacity; }
+
+typedef struct {
+    arena_t* scratch;
+    string_view_t source;
+
+    ARRAY(slot_state_t) slots;
+    ARRAY(trail_entry_t) trail;
+    ARRAY(trail_entry_t) branch;
+    ARRAY(bounds_frame_t) frames;
+
+    uint32_t stamp;
+    interval_t current;
+
+    // Last comparison evaluated, with the range of its operands.
+    const ast_node_t* compared;
+    interval_t compared_left;
+    interval_t compared_right;
+
+    size_t assignments;
+    bounds_stats_t* stats;
+    bool had_error;
+
+    // False inside a branch whose condition can't hold.
+    bool is_reachable;
+} bounds_analyzer_t;
+
+static void grow_array(arena_t* arena, void** items, uint32_t* capacity, uint32_t count, size_t item_size) {
+    const uint32_t new_capacity = *capacity != 0 ? *capacity * 2 : INITIAL_CAPACITY;
+    void* const new_items = ARENA_MALLOC(arena, void*, item_size * new_capacity);
+
+    if(count > 0) {
+        memcpy(new_items, *items, item_size * count);
+    }
+
+    *items = new_items;
+    *capacity = new_capacity;
+}
+
+#define PUSH(analyzer, array, ...)                                                  \
+    (((array).count == (array).capacity                                             \
+      ? grow_array((analyzer)->scratch, (void**)&(array).items, &(array).capacity,  \
+                   (array).count, sizeof(*(array).items))                           \
+      : (void)0),                                                                   \
+     (array).items[(array).count] = __VA_ARGS__,                                    \
+     (array).count++)
+
+// Slots are handed out by the typechecker, the states are added on first use.
+static slot_state_t* slot_state(bounds_analyzer_t* analyzer, uint32_t slot) {
+    while(slot >= analyzer->slots.count) {
+        PUSH(analyzer, analyzer->slots, (slot_state_t) {
+            .value = UNKNOWN_RANGE,
+            .else_value = UNKNOWN_RANGE,
+            .then_stamp = 0,
+            .else_stamp = 0
+        });
+    }
+
+    return &analyzer->slots.items[slot];
+}
+
+// The previous value is kept on the trail, to leave a branch.
+static void set_value(bounds_analyzer_t* analyzer, uint32_t slot, interval_t value) {
+    slot_state_t* const state = slot_state(analyzer, slot);
+
+    PUSH(analyzer, analyzer->trail, (trail_entry_t) {
+        .slot = slot,
+        .value = state->value
+    });
+
+    state->value = value;
+}
+
+static void undo_trail(bounds_analyzer_t* analyzer, uint32_t mark) {
+    while(analyzer->trail.count > mark) {
+        const trail_entry_t entry = analyzer->trail.items[--analyzer->trail.count];
+        analyzer->slots.items[entry.slot].value = entry.value;
+    }
+}
+
+static inline bool is_integer(const ast_node_t* node) {
+    return node->type != NULL && IS_INTEGER_TYPE(node->type);
+}
+
+// A narrower integer wraps around, a range it can't hold becomes all of its values.
+static inline interval_t fit_type(const type_t* type, interval_t value) {
+    int64_t low, high;
+    integer_type_range(type, &low, &high);
+
+    return value.low >= low && value.high <= high ? value : make_interval(low, high);
+}
+
+// Slot of an integer variable, SYMBOL_NO_SLOT for anything else.
+static inline uint32_t integer_slot(const ast_node_t* node) {
+    if(node->kind != VARIABLE_EXPR_NODE || !is_integer(node)) return SYMBOL_NO_SLOT;
+
+    return ((variable_expr_t*)node)->slot;
+}
+
+// Only integer expressions have a range.
+static inline void set_result(bounds_analyzer_t* analyzer, const ast_node_t* node, interval_t value) {
+    analyzer->current = is_integer(node) ? fit_type(node->type, value) : UNKNOWN_RANGE;
+}
+
+static inline bool analyze_leaf(bounds_analyzer_t* analyzer, const ast_node_t* node) {
+    switch(node->kind) {
+        case VARIABLE_EXPR_NODE: {
+            const uint32_t slot = integer_slot(node);
+
+            analyzer->current = slot != SYMBOL_NO_SLOT
+                ? fit_type(node->type, slot_state(analyzer, slot)->value)
+                : UNKNOWN_RANGE;
+
+            return true;
+        }
+        case LITERAL_NODE: {
+            const literal_expr_t* const lit = (literal_expr_t*)node;
+            analyzer->current = UNKNOWN_RANGE;
+
+            if(IS_INTEGER_TYPE(lit->type)) {
+                const int64_t value = lit->value.integer;
+                analyzer->current = fit_type(lit->type, make_interval(value, value));
+            }
+
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static inline void push_node(bounds_analyzer_t* analyzer, const ast_node_t* node) {
+    if(analyze_leaf(analyzer, node)) return;
+
+    PUSH(analyzer, analyzer->frames, (bounds_frame_t) {
+        .node = node,
+        .stage = 0
+    });
+}
+
+// =============== Conditions ===============
+
+static token_type_t negate_comparison(token_type_t op) {
+    switch(op) {
+        case LESS: return GREATER_EQ;
+        case GREATER: return LESS_EQ;
+        case LESS_EQ: return GREATER;
+        case GREATER_EQ: return LESS;
+        default: return op;
+    }
+}
+
+// `a op b` as `b op' a`.
+static token_type_t mirror_comparison(token_type_t op) {
+    switch(op) {
+        case LESS: return GREATER;
+        case GREATER: return LESS;
+        case LESS_EQ: return GREATER_EQ;
+        case GREATER_EQ: return LESS_EQ;
+        default: return op;
+    }
+}
+
+// Keeps the values of the variable for which `variable op other` can hold.
+// Returns false when there are none, the branch can't be taken.
+static bool narrow_variable(bounds_analyzer_t* analyzer, const ast_node_t* variable,
+                            token_type_t op, interval_t other) {
+    const uint32_t slot = integer_slot(variable);
+    if(slot == SYMBOL_NO_SLOT) return true;
+
+    const interval_t value = fit_type(variable->type, slot_state(analyzer, slot)->value);
+    interval_t narrowed = value;
+
+    switch(op) {
+        case LESS:
+            if(other.high == INT64_MIN) return false;
+            if(other.high - 1 < narrowed.high) narrowed.high = other.high - 1;
+            break;
+        case LESS_EQ:
+            if(other.high < narrowed.high) narrowed.high = other.high;
+            break;
+        case GREATER:
+            if(other.low == INT64_MAX) return false;
+            if(other.low + 1 > narrowed.low) narrowed.low = other.low + 1;
+            break;
+        case GREATER_EQ:
+            if(other.low > narrowed.low) narrowed.low = other.low;
+            break;
+        default:
+            return true;
+    }
+
+    if(narrowed.low > narrowed.high) return false;
+    if(narrowed.low == value.low && narrowed.high == value.high) return true;
+
+    set_value(analyzer, slot, narrowed);
+    return true;
+}
+
+// Returns false when the branch can't be taken.
+static bool narrow_condition(bounds_analyzer_t* analyzer, const bounds_frame_t* frame, bool taken) {
+    const binary_expr_t* const expr = (binary_expr_t*)((if_statement_t*)frame->node)->condition;
+    const token_type_t op = taken ? expr->op.type : negate_comparison(expr->op.type);
+
+    const bool left = narrow_variable(analyzer, expr->left, op, frame->other);
+    const bool right = narrow_variable(analyzer, expr->right, mirror_comparison(op), frame->saved);
+
+    return left && right;
+}
+
+// Both branches are done and undone: each variable they assigned gets the
+// values it can have after either one. A branch that can't be reached adds
+// none of its values.
+static void join_branches(bounds_analyzer_t* analyzer, const bounds_frame_t* frame, bool else_reachable) {
+    const uint32_t else_stamp = ++analyzer->stamp;
+    const uint32_t else_begin = analyzer->branch.count;
+
+    for(uint32_t i = frame->mark; i < analyzer->trail.count; i++) {
+        const uint32_t slot = analyzer->trail.items[i].slot;
+        slot_state_t* const state = &analyzer->slots.items[slot];
+
+        if(state->else_stamp == else_stamp) continue;
+
+        state->else_stamp = else_stamp;
+        state->else_value = state->value;
+
+        PUSH(analyzer, analyzer->branch, (trail_entry_t) {
+            .slot = slot,
+            .value = state->value
+        });
+    }
+
+    undo_trail(analyzer, frame->mark);
+
+    const uint32_t then_stamp = ++analyzer->stamp;
+    const uint32_t then_end = frame->then_reachable ? frame->branch + frame->branch_count : frame->branch;
+
+    for(uint32_t i = frame->branch; i < then_end; i++) {
+        const trail_entry_t entry = analyzer->branch.items[i];
+        slot_state_t* const state = &analyzer->slots.items[entry.slot];
+
+        const interval_t otherwise = state->else_stamp == else_stamp ? state->else_value : state->value;
+
+        state->then_stamp = then_stamp;
+        set_value(analyzer, entry.slot, else_reachable ? join_intervals(entry.value, otherwise) : entry.value);
+    }
+
+    const uint32_t else_end = else_reachable ? analyzer->branch.count : else_begin;
+
+    for(uint32_t i = else_begin; i < else_end; i++) {
+        const trail_entry_t entry = analyzer->branch.items[i];
+        const slot_state_t* const state = &analyzer->slots.items[entry.slot];
+
+        if(state->then_stamp == then_stamp) continue;
+
+        set_value(analyzer, entry.slot, frame->then_reachable ? join_intervals(entry.value, state->value) : entry.value);
+    }
+
+    analyzer->branch.count = frame->branch;
+}
+
+// =============== Subscripts ===============
+
+static void check_subscript(bounds_analyzer_t* analyzer, subscript_expr_t* expr, interval_t index) {
+    const type_t* const array = expr->lvalue->type;
+    if(array == NULL || array->kind != TYPE_ARRAY) return;
+
+    // Code that never runs can't go out of range.
+    if(!analyzer->is_reachable) {
+        expr->bounds = BOUNDS_UNKNOWN;
+        return;
+    }
+
+    analyzer->stats->accesses++;
+
+    if(index.low >= 0 && index.high < array->length) {
+        expr->bounds = BOUNDS_IN_RANGE;
+        analyzer->stats->in_range++;
+        return;
+    }
+
+    if(index.high < 0 || index.low >= array->length) {
+        expr->bounds = BOUNDS_OUT_OF_RANGE;
+        analyzer->stats->out_of_range++;
+        analyzer->had_error = true;
+
+        const int line = source_location(analyzer->source, expr->offset).line;
+
+        if(index.low == index.high) {
+            fprintf(stderr, "[Ln: %d] Index %lld is out of range for an array of length %d.\n",
+                    line, (long long)index.low, array->length);
+        } else {
+            fprintf(stderr, "[Ln: %d] Index from %lld to %lld is out of range for an array of length %d.\n",
+                    line, (long long)index.low, (long long)index.high, array->length);
+        }
+
+        return;
+    }
+
+    expr->bounds = BOUNDS_UNKNOWN;
+}
+
+// =============== Traversal ===============
+
+static void analyze_decl(bounds_analyzer_t* analyzer, const ast_node_t* root) {
+
+    push_node(analyzer, root);
+
+    while(analyzer->frames.count > 0) {
+        bounds_frame_t* const frame = &analyzer->frames.items[analyzer->frames.count - 1];
+        const ast_node_t* const node = frame->node;
+
+        switch(node->kind) {
+            case VARIABLE_DECL_NODE: {
+                const variable_decl_t* const decl = (variable_decl_t*)node;
+
+                if(frame->stage++ == 0 && decl->rvalue != NULL) {
+                    push_node(analyzer, decl->rvalue);
+                    continue;
+                }
+
+                if(decl->slot != SYMBOL_NO_SLOT) {
+                    set_value(analyzer, decl->slot, decl->rvalue != NULL ? analyzer->current : UNKNOWN_RANGE);
+                }
+
+                break;
+            }
+            case IF_STATEMENT_NODE: {
+                const if_statement_t* const stmt = (if_statement_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        frame->assignments = analyzer->assignments;
+                        push_node(analyzer, stmt->condition);
+                        continue;
+                    case 1:
+                        // A condition which assigns compares values the variables no longer have.
+                        frame->is_narrowing = analyzer->compared == stmt->condition &&
+                                              analyzer->assignments == frame->assignments;
+
+                        frame->saved = analyzer->compared_left;
+                        frame->other = analyzer->compared_right;
+                        frame->mark = analyzer->trail.count;
+                        frame->was_reachable = analyzer->is_reachable;
+
+                        if(frame->is_narrowing && !narrow_condition(analyzer, frame, true)) {
+                            analyzer->is_reachable = false;
+                        }
+
+                        push_node(analyzer, stmt->then);
+                        continue;
+                    case 2: {
+                        const uint32_t stamp = ++analyzer->stamp;
+                        frame->branch = analyzer->branch.count;
+
+                        for(uint32_t i = frame->mark; i < analyzer->trail.count; i++) {
+                            const uint32_t slot = analyzer->trail.items[i].slot;
+                            slot_state_t* const state = &analyzer->slots.items[slot];
+
+                            if(state->then_stamp == stamp) continue;
+                            state->then_stamp = stamp;
+
+                            PUSH(analyzer, analyzer->branch, (trail_entry_t) {
+                                .slot = slot,
+                                .value = state->value
+                            });
+                        }
+
+                        frame->branch_count = analyzer->branch.count - frame->branch;
+                        undo_trail(analyzer, frame->mark);
+
+                        frame->then_reachable = analyzer->is_reachable;
+                        analyzer->is_reachable = frame->was_reachable;
+
+                        if(frame->is_narrowing && !narrow_condition(analyzer, frame, false)) {
+                            analyzer->is_reachable = false;
+                        }
+
+                        if(stmt->otherwise != NULL) {
+                            push_node(analyzer, stmt->otherwise);
+                            continue;
+                        }
+                    }
+                    case 3:
+                        join_branches(analyzer, frame, analyzer->is_reachable);
+                        analyzer->is_reachable = frame->was_reachable;
+                        break;
+                }
+
+                break;
+            }
+            case EXPR_STATEMENT_NODE: {
+                const expr_statement_t* const stmt = (expr_statement_t*)node;
+
+                if(frame->stage++ == 0) {
+                    push_node(analyzer, stmt->expr);
+                    continue;
+                }
+
+                break;
+            }
+            case ASSIGN_EXPR_NODE: {
+                const assign_expr_t* const expr = (assign_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        push_node(analyzer, expr->lvalue);
+                        continue;
+                    case 1:
+                        push_node(analyzer, expr->rvalue);
+                        continue;
+                }
+
+                const uint32_t slot = integer_slot(expr->lvalue);
+                if(slot != SYMBOL_NO_SLOT) {
+                    set_value(analyzer, slot, analyzer->current);
+                }
+
+                analyzer->assignments++;
+                set_result(analyzer, node, analyzer->current);
+                break;
+            }
+            case BINARY_EXPR_NODE: {
+                const binary_expr_t* const expr = (binary_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        push_node(analyzer, expr->left);
+                        continue;
+                    case 1:
+                        frame->saved = analyzer->current;
+                        push_node(analyzer, expr->right);
+                        continue;
+                }
+
+                switch(expr->op.type) {
+                    case LESS:
+                    case GREATER:
+                    case LESS_EQ:
+                    case GREATER_EQ:
+                        analyzer->compared = node;
+                        analyzer->compared_left = frame->saved;
+                        analyzer->compared_right = analyzer->current;
+
+                        analyzer->current = UNKNOWN_RANGE;
+                        break;
+                    default:
+                        set_result(analyzer, node, arithmetic_interval(expr->op.type, frame->saved, analyzer->current));
+                        break;
+                }
+
+                break;
+            }
+            case UNARY_EXPR_NODE: {
+                const unary_expr_t* const expr = (unary_expr_t*)node;
+
+                if(frame->stage++ == 0) {
+                    push_node(analyzer, expr->right);
+                    continue;
+                }
+
+                const interval_t value = analyzer->current;
+
+                if(expr->op.type == MINUS) {
+                    set_result(analyzer, node, value.low != INT64_MIN
+                        ? make_interval(-value.high, -value.low)
+                        : UNKNOWN_RANGE);
+                } else {
+                    set_result(analyzer, node, value);
+                }
+
+                break;
+            }
+            case CASTING_EXPR_NODE: {
+                const casting_expr_t* const expr = (casting_expr_t*)node;
+
+                if(frame->stage++ == 0) {
+                    push_node(analyzer, expr->expr);
+                    continue;
+                }
+
+                // Floats are truncated, their range is not tracked.
+                const type_t* const from = expr->expr->type;
+
+                if(from != NULL && are_types_equal(from, bool_type)) {
+                    set_result(analyzer, node, make_interval(0, 1));
+                } else if(is_integer(expr->expr)) {
+                    set_result(analyzer, node, analyzer->current);
+                } else {
+                    analyzer->current = UNKNOWN_RANGE;
+                }
+
+                break;
+            }
+            case SUBSCRIPT_EXPR_NODE: {
+                subscript_expr_t* const expr = (subscript_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        push_node(analyzer, expr->lvalue);
+                        continue;
+                    case 1:
+                        push_node(analyzer, expr->index);
+                        continue;
+                }
+
+                check_subscript(analyzer, expr, analyzer->current);
+
+                // The values stored in arrays are not tracked.
+                analyzer->current = UNKNOWN_RANGE;
+                break;
+            }
+            case ELEMENT_EXPR_NODE: {
+                const element_expr_t* const expr = (element_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        push_node(analyzer, expr->array);
+                        continue;
+                    case 1:
+                        push_node(analyzer, expr->offset);
+                        continue;
+                }
+
+                analyzer->current = UNKNOWN_RANGE;
+                break;
+            }
+            case INITIALIZER_NODE: {
+                const initializer_t* const initializer = (initializer_t*)node;
+
+                if(frame->stage == 0) {
+                    frame->stage = 1;
+                    frame->it = initializer->init;
+                }
+
+                if(frame->it != NULL) {
+                    const ast_node_t* const element = frame->it;
+                    frame->it = element->next;
+
+                    push_node(analyzer, element);
+                    continue;
+                }
+
+                analyzer->current = UNKNOWN_RANGE;
+                break;
+            }
+            default:
+                break;
+        }
+
+        analyzer->frames.count--;
+    }
+}
+
+bool analyze_bounds(const ast_node_t* program, string_view_t source, bounds_stats_t* stats) {
+    bounds_analyzer_t analyzer = {
+        .scratch = create_arena(SCRATCH_CHUNK_SIZE),
+        .source = source,
+        .stamp = 0,
+        .current = UNKNOWN_RANGE,
+        .compared = NULL,
+        .assignments = 0,
+        .stats = stats,
+        .had_error = false,
+        .is_reachable = true
+    };
+
+    for(const ast_node_t* decl = program; decl != NULL; decl = decl->next) {
+        // Branches are statements, no `if` is left open between declarations.
+        analyzer.trail.count = 0;
+        analyze_decl(&analyzer, decl);
+    }
+
+    destroy_arena(analyzer.scratch);
+    return !analyzer.had_error;
+}
+
+#undef PUSH
+#undef ARRAY
+#undef INITIAL_CAPACITY
+#undef SCRATCH_CHUNK_SIZE
@@ -0,0 +1,607 @@
+#include "../include/flat_ast.h"
+#include "../include/memory.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_TYPE ((uint32_t)-1)
+
+// Indices a node reference can hold.
+#define NODE_REF_LIMIT (NODE_REF_INDEX(UINT32_MAX) + (size_t)1)
+
+// The arrays are allocated once, at the size counted before flattening.
+#define RESERVE(array, n)                                               \
+    ((array).items = MALLOC(void*, sizeof(*(array).items) * (n)),       \
+     (array).capacity = (uint32_t)(n))
+
+// Appends `value` and evaluates to its index.
+#define PUSH(array, ...)                                                \
+    ((array).items[(array).count] = __VA_ARGS__, (array).count++)
+
+// The nodes are flattened in post-order without recursion: a frame keeps
+// the references of the children flattened so far.
+typedef struct {
+    const ast_node_t* node;
+
+    // Next element of an initializer, and where its reference goes.
+    const ast_node_t* it;
+    uint32_t slot;
+
+    node_ref_t children[3];
+    uint8_t stage;
+} flatten_frame_t;
+
+typedef struct {
+    flatten_frame_t* items;
+    size_t count;
+    size_t capacity;
+} flatten_stack_t;
+
+static void push_flatten_frame(flatten_stack_t* stack, const ast_node_t* node) {
+    if(stack->count == stack->capacity) {
+        stack->capacity = stack->capacity != 0 ? stack->capacity * 2 : 64;
+        stack->items = realloc(stack->items, sizeof(flatten_frame_t) * stack->capacity);
+
+        if(stack->items == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    stack->items[stack->count++] = (flatten_frame_t) {
+        .node = node,
+        .stage = 0
+    };
+}
+
+// Children in the order they are flattened, missing ones are NULL.
+static uint32_t node_children(const ast_node_t* node, const ast_node_t* children[3]) {
+
+    switch(node->kind) {
+        case VARIABLE_DECL_NODE:
+            children[0] = ((variable_decl_t*)node)->rvalue;
+            return 1;
+        case IF_STATEMENT_NODE: {
+            const if_statement_t* const stmt = (if_statement_t*)node;
+
+            children[0] = stmt->condition;
+            children[1] = stmt->then;
+            children[2] = stmt->otherwise;
+            return 3;
+        }
+        case EXPR_STATEMENT_NODE:
+            children[0] = ((expr_statement_t*)node)->expr;
+            return 1;
+        case ASSIGN_EXPR_NODE:
+            children[0] = ((assign_expr_t*)node)->lvalue;
+            children[1] = ((assign_expr_t*)node)->rvalue;
+            return 2;
+        case BINARY_EXPR_NODE:
+            children[0] = ((binary_expr_t*)node)->left;
+            children[1] = ((binary_expr_t*)node)->right;
+            return 2;
+        case UNARY_EXPR_NODE:
+            children[0] = ((unary_expr_t*)node)->right;
+            return 1;
+        case CASTING_EXPR_NODE:
+            children[0] = ((casting_expr_t*)node)->expr;
+            return 1;
+        case SUBSCRIPT_EXPR_NODE:
+            children[0] = ((subscript_expr_t*)node)->lvalue;
+            children[1] = ((subscript_expr_t*)node)->index;
+            return 2;
+        case ELEMENT_EXPR_NODE:
+            children[0] = ((element_expr_t*)node)->array;
+            children[1] = ((element_expr_t*)node)->offset;
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Appends a node whose children are already flattened.
+static node_ref_t emit_node(flat_ast_t* ast, const ast_node_t* node, const node_ref_t children[3]) {
+
+    switch(node->kind) {
+        case VARIABLE_DECL_NODE: {
+            const variable_decl_t* const decl = (variable_decl_t*)node;
+
+            const uint32_t index = PUSH(ast->variable_decls, (flat_variable_decl_t) {
+                .name = decl->name.id,
+                .is_type_inferred = decl->is_type_inferred,
+                .type = decl->type != NULL ? decl->type->id : NO_TYPE,
+                .rvalue = children[0]
+            });
+
+            return NODE_REF(VARIABLE_DECL_NODE, index);
+        }
+        case IF_STATEMENT_NODE: {
+            const uint32_t index = PUSH(ast->if_statements, (flat_if_statement_t) {
+                .condition = children[0],
+                .then = children[1],
+                .otherwise = children[2]
+            });
+
+            return NODE_REF(IF_STATEMENT_NODE, index);
+        }
+        case EXPR_STATEMENT_NODE: {
+            const uint32_t index = PUSH(ast->expr_statements, (flat_expr_statement_t) {
+                .expr = children[0]
+            });
+
+            return NODE_REF(EXPR_STATEMENT_NODE, index);
+        }
+        case ASSIGN_EXPR_NODE: {
+            const uint32_t index = PUSH(ast->assign_exprs, (flat_assign_expr_t) {
+                .lvalue = children[0],
+                .rvalue = children[1]
+            });
+
+            return NODE_REF(ASSIGN_EXPR_NODE, index);
+        }
+        case BINARY_EXPR_NODE: {
+            const binary_expr_t* const expr = (binary_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->binary_exprs, (flat_binary_expr_t) {
+                .op = expr->op.type,
+                .left = children[0],
+                .right = children[1]
+            });
+
+            return NODE_REF(BINARY_EXPR_NODE, index);
+        }
+        case UNARY_EXPR_NODE: {
+            const unary_expr_t* const expr = (unary_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->unary_exprs, (flat_unary_expr_t) {
+                .op = expr->op.type,
+                .right = children[0]
+            });
+
+            return NODE_REF(UNARY_EXPR_NODE, index);
+        }
+        case CASTING_EXPR_NODE: {
+            const casting_expr_t* const expr = (casting_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->casting_exprs, (flat_casting_expr_t) {
+                .expr = children[0],
+                .target_type = expr->target_type->id
+            });
+
+            return NODE_REF(CASTING_EXPR_NODE, index);
+        }
+        case SUBSCRIPT_EXPR_NODE: {
+            const subscript_expr_t* const expr = (subscript_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->subscript_exprs, (flat_subscript_expr_t) {
+                .lvalue = children[0],
+                .index = children[1],
+                .bounds = (uint8_t)expr->bounds
+            });
+
+            return NODE_REF(SUBSCRIPT_EXPR_NODE, index);
+        }
+        case VARIABLE_EXPR_NODE: {
+            const variable_expr_t* const var = (variable_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->variable_exprs, (flat_variable_expr_t) {
+                .name = var->name.id
+            });
+
+            return NODE_REF(VARIABLE_EXPR_NODE, index);
+        }
+        case LITERAL_NODE: {
+            const literal_expr_t* const lit = (literal_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->literal_exprs, (flat_literal_expr_t) {
+                .type = lit->type->id,
+                .value = lit->value
+            });
+
+            return NODE_REF(LITERAL_NODE, index);
+        }
+        case ELEMENT_EXPR_NODE: {
+            const element_expr_t* const expr = (element_expr_t*)node;
+
+            const uint32_t index = PUSH(ast->element_exprs, (flat_element_expr_t) {
+                .array = children[0],
+                .offset = children[1],
+                .dimensions = (uint32_t)expr->dimensions,
+                .bounds = (uint8_t)expr->bounds,
+                .is_packed = expr->is_packed
+            });
+
+            return NODE_REF(ELEMENT_EXPR_NODE, index);
+        }
+        case INITIALIZER_NODE:
+            break;
+    }
+
+    return NULL_NODE_REF;
+}
+
+static node_ref_t flatten_node(flat_ast_t* ast, const ast_node_t* root, flatten_stack_t* stack) {
+
+    node_ref_t result = NULL_NODE_REF;
+    push_flatten_frame(stack, root);
+
+    while(stack->count > 0) {
+        flatten_frame_t* const frame = &stack->items[stack->count - 1];
+        const ast_node_t* const node = frame->node;
+
+        if(node->kind == INITIALIZER_NODE) {
+            const initializer_t* const list = (initializer_t*)node;
+
+            if(frame->stage == 0) {
+                // `stage` is a byte, it can't count the elements.
+                frame->stage = 1;
+
+                uint32_t count = 0;
+                for(const ast_node_t* it = list->init; it != NULL; it = it->next) {
+                    count++;
+                }
+
+                // Take the slice first, so that nested lists can't interleave with it.
+                frame->children[0] = ast->elements.count;
+                frame->children[1] = count;
+                frame->slot = ast->elements.count;
+                frame->it = list->init;
+
+                ast->elements.count += count;
+            } else {
+                ast->elements.items[frame->slot++] = result;
+                frame->it = frame->it->next;
+            }
+
+            if(frame->it != NULL) {
+                push_flatten_frame(stack, frame->it);
+                continue;
+            }
+
+            const uint32_t index = PUSH(ast->initializers, (flat_initializer_t) {
+                .first = frame->children[0],
+                .count = frame->children[1],
+                .bits = list->bits,
+                .bit_count = list->bit_count
+            });
+
+            result = NODE_REF(INITIALIZER_NODE, index);
+            stack->count--;
+            continue;
+        }
+
+        const ast_node_t* children[3];
+        const uint32_t count = node_children(node, children);
+
+        if(frame->stage > 0) {
+            frame->children[frame->stage - 1] = result;
+        }
+
+        while(frame->stage < count && children[frame->stage] == NULL) {
+            frame->children[frame->stage++] = NULL_NODE_REF;
+        }
+
+        if(frame->stage < count) {
+            push_flatten_frame(stack, children[frame->stage++]);
+            continue;
+        }
+
+        result = emit_node(ast, node, frame->children);
+        stack->count--;
+    }
+
+    return result;
+}
+
+// Nodes of each kind in the program, and elements of its initializers.
+typedef struct {
+    size_t nodes[ELEMENT_EXPR_NODE + 1];
+    size_t elements;
+    size_t decls;
+} node_counts_t;
+
+static node_counts_t count_nodes(const ast_node_t* program, flatten_stack_t* stack) {
+    node_counts_t counts = {0};
+
+    for(const ast_node_t* decl = program; decl != NULL; decl = decl->next) {
+        push_flatten_frame(stack, decl);
+        counts.decls++;
+
+        while(stack->count > 0) {
+            const ast_node_t* const node = stack->items[--stack->count].node;
+            counts.nodes[node->kind]++;
+
+            if(node->kind == INITIALIZER_NODE) {
+                for(const ast_node_t* it = ((initializer_t*)node)->init; it != NULL; it = it->next) {
+                    push_flatten_frame(stack, it);
+                    counts.elements++;
+                }
+
+                continue;
+            }
+
+            const ast_node_t* children[3];
+            const uint32_t count = node_children(node, children);
+
+            for(uint32_t i = 0; i < count; i++) {
+                if(children[i] != NULL) {
+                    push_flatten_frame(stack, children[i]);
+                }
+            }
+        }
+    }
+
+    return counts;
+}
+
+flat_ast_t flatten_ast(const ast_node_t* program) {
+    flat_ast_t ast = {0};
+    flatten_stack_t stack = {0};
+
+    const node_counts_t counts = count_nodes(program, &stack);
+
+    for(size_t kind = 0; kind <= ELEMENT_EXPR_NODE; kind++) {
+        if(counts.nodes[kind] > NODE_REF_LIMIT) {
+            fprintf(stderr, "flat_ast: The program has more than %zu nodes of a kind.\n", NODE_REF_LIMIT);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(counts.elements > UINT32_MAX || counts.decls > UINT32_MAX) {
+        fprintf(stderr, "flat_ast: The program is too large.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    RESERVE(ast.variable_decls, counts.nodes[VARIABLE_DECL_NODE]);
+    RESERVE(ast.if_statements, counts.nodes[IF_STATEMENT_NODE]);
+    RESERVE(ast.expr_statements, counts.nodes[EXPR_STATEMENT_NODE]);
+    RESERVE(ast.assign_exprs, counts.nodes[ASSIGN_EXPR_NODE]);
+    RESERVE(ast.binary_exprs, counts.nodes[BINARY_EXPR_NODE]);
+    RESERVE(ast.unary_exprs, counts.nodes[UNARY_EXPR_NODE]);
+    RESERVE(ast.casting_exprs, counts.nodes[CASTING_EXPR_NODE]);
+    RESERVE(ast.subscript_exprs, counts.nodes[SUBSCRIPT_EXPR_NODE]);
+    RESERVE(ast.variable_exprs, counts.nodes[VARIABLE_EXPR_NODE]);
+    RESERVE(ast.initializers, counts.nodes[INITIALIZER_NODE]);
+    RESERVE(ast.literal_exprs, counts.nodes[LITERAL_NODE]);
+    RESERVE(ast.element_exprs, counts.nodes[ELEMENT_EXPR_NODE]);
+    RESERVE(ast.elements, counts.elements);
+    RESERVE(ast.decls, counts.decls);
+
+    for(const ast_node_t* it = program; it != NULL; it = it->next) {
+        const node_ref_t decl = flatten_node(&ast, it, &stack);
+        PUSH(ast.decls, decl);
+    }
+
+    free(stack.items);
+    return ast;
+}
+
+#undef PUSH
+#undef RESERVE
+#undef NODE_REF_LIMIT
+
+#define ARRAY_SIZE(array) ((size_t)(array).capacity * sizeof(*(array).items))
+
+size_t flat_ast_size(const flat_ast_t* ast) {
+    return ARRAY_SIZE(ast->variable_decls) + ARRAY_SIZE(ast->if_statements) +
+        ARRAY_SIZE(ast->expr_statements) + ARRAY_SIZE(ast->assign_exprs) +
+        ARRAY_SIZE(ast->binary_exprs) + ARRAY_SIZE(ast->unary_exprs) +
+        ARRAY_SIZE(ast->casting_exprs) + ARRAY_SIZE(ast->subscript_exprs) +
+        ARRAY_SIZE(ast->variable_exprs) + ARRAY_SIZE(ast->initializers) +
+        ARRAY_SIZE(ast->literal_exprs) + ARRAY_SIZE(ast->element_exprs) +
+        ARRAY_SIZE(ast->elements) + ARRAY_SIZE(ast->decls);
+}
+
+#undef ARRAY_SIZE
+
+// =============== Flat AST Printer ===============
+
+// Pre-order with an explicit stack, like the printer of the pointer AST.
+typedef struct {
+    node_ref_t ref;
+    int level;
+} print_frame_t;
+
+typedef struct {
+    print_frame_t* items;
+    size_t count;
+    size_t capacity;
+} print_stack_t;
+
+static void push_child(print_stack_t* stack, node_ref_t ref, int level) {
+    if(ref == NULL_NODE_REF) return;
+
+    if(stack->count == stack->capacity) {
+        stack->capacity = stack->capacity != 0 ? stack->capacity * 2 : 64;
+        stack->items = realloc(stack->items, sizeof(print_frame_t) * stack->capacity);
+
+        if(stack->items == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    stack->items[stack->count++] = (print_frame_t) {
+        .ref = ref,
+        .level = level
+    };
+}
+
+// Same annotations as the printer of the pointer AST.
+static const char* const bounds_names[] = {
+    [BOUNDS_UNKNOWN] = "",
+    [BOUNDS_IN_RANGE] = "in range",
+    [BOUNDS_OUT_OF_RANGE] = "out of range"
+};
+
+static inline void print_tab(const int level) {
+    for(int i = 0; i < level; i++) {
+        printf("  ");
+    }
+}
+
+static void print_flat_node(const flat_ast_t* ast, node_ref_t ref, int level, print_stack_t* stack) {
+
+    putchar('\n');
+    print_tab(level);
+
+    const uint32_t index = NODE_REF_INDEX(ref);
+
+    switch(NODE_REF_KIND(ref)) {
+        case VARIABLE_DECL_NODE: {
+
+            const flat_variable_decl_t* const decl = &ast->variable_decls.items[index];
+
+            printf("variable_decl: "STRING_VIEW_FORMAT" ", STRING_VIEW_ARG(interned_name(decl->name)));
+            if(!decl->is_type_inferred) {
+                print_type(type_from_id(decl->type));
+            }
+
+            push_child(stack, decl->rvalue, level+1);
+            break;
+        }
+        case IF_STATEMENT_NODE: {
+
+            const flat_if_statement_t* const stmt = &ast->if_statements.items[index];
+
+            printf("if_statement: ");
+            push_child(stack, stmt->condition, level+1);
+            push_child(stack, stmt->then, level+1);
+            push_child(stack, stmt->otherwise, level+1);
+
+            break;
+        }
+        case EXPR_STATEMENT_NODE: {
+
+            const flat_expr_statement_t* const stmt = &ast->expr_statements.items[index];
+
+            printf("expr_statement: ");
+            push_child(stack, stmt->expr, level+1);
+            break;
+        }
+        case ASSIGN_EXPR_NODE: {
+
+            const flat_assign_expr_t* const expr = &ast->assign_exprs.items[index];
+
+            printf("assign_expr: ");
+            push_child(stack, expr->lvalue, level+1);
+            push_child(stack, expr->rvalue, level+1);
+
+            break;
+        }
+        case BINARY_EXPR_NODE: {
+
+            const flat_binary_expr_t* const expr = &ast->binary_exprs.items[index];
+
+            printf("binary_expr: %s", token_spelling(expr->op));
+            push_child(stack, expr->left, level+1);
+            push_child(stack, expr->right, level+1);
+
+            break;
+        }
+        case UNARY_EXPR_NODE: {
+
+            const flat_unary_expr_t* const expr = &ast->unary_exprs.items[index];
+
+            printf("unary_expr: %s", token_spelling(expr->op));
+            push_child(stack, expr->right, level+1);
+
+            break;
+        }
+        case CASTING_EXPR_NODE: {
+
+            const flat_casting_expr_t* const expr = &ast->casting_exprs.items[index];
+
+            printf("casting_expr: ");
+            print_type(type_from_id(expr->target_type));
+            push_child(stack, expr->expr, level+1);
+
+            break;
+        }
+        case SUBSCRIPT_EXPR_NODE: {
+
+            const flat_subscript_expr_t* const expr = &ast->subscript_exprs.items[index];
+
+            printf("subscript_expr: %s", bounds_names[expr->bounds]);
+            push_child(stack, expr->lvalue, level+1);
+            push_child(stack, expr->index, level+1);
+
+            break;
+        }
+        case VARIABLE_EXPR_NODE: {
+
+            const flat_variable_expr_t* const var = &ast->variable_exprs.items[index];
+
+            printf("variable_expr: "STRING_VIEW_FORMAT,
+                   STRING_VIEW_ARG(interned_name(var->name)));
+
+            break;
+        }
+        case INITIALIZER_NODE: {
+
+            const flat_initializer_t* const list = &ast->initializers.items[index];
+
+            printf("initializer: ");
+            if(list->bits != NULL) {
+                print_packed_bits(list->bits, list->bit_count);
+            }
+
+            for(uint32_t i = 0; i < list->count; i++) {
+                push_child(stack, ast->elements.items[list->first + i], level+1);
+            }
+
+            break;
+        }
+        case ELEMENT_EXPR_NODE: {
+
+            const flat_element_expr_t* const expr = &ast->element_exprs.items[index];
+
+            printf("element_expr: %s%s", expr->is_packed ? "packed " : "", bounds_names[expr->bounds]);
+            push_child(stack, expr->array, level+1);
+            push_child(stack, expr->offset, level+1);
+
+            break;
+        }
+        case LITERAL_NODE: {
+
+            const flat_literal_expr_t* const lit = &ast->literal_exprs.items[index];
+
+            if(IS_FLOAT_TYPE(type_from_id(lit->type))) {
+                printf("literal_expr: %g (", lit->value.real);
+            } else {
+                printf("literal_expr: %" PRId64 " (", lit->value.integer);
+            }
+
+            print_type(type_from_id(lit->type));
+            putchar(')');
+
+            break;
+        }
+    }
+}
+
+void print_flat_ast(const flat_ast_t* ast) {
+    print_stack_t stack = {0};
+
+    for(uint32_t i = 0; i < ast->decls.count; i++) {
+        push_child(&stack, ast->decls.items[i], 0);
+
+        while(stack.count > 0) {
+            const print_frame_t frame = stack.items[--stack.count];
+            const size_t first = stack.count;
+
+            print_flat_node(ast, frame.ref, frame.level, &stack);
+
+            // The children were pushed in order, they have to be popped in order.
+            for(size_t lo = first, hi = stack.count; lo + 1 < hi; lo++, hi--) {
+                const print_frame_t tmp = stack.items[lo];
+                stack.items[lo] = stack.items[hi - 1];
+                stack.items[hi - 1] = tmp;
+            }
+        }
+    }
+
+    free(stack.items);
+}
@@ -0,0 +1,163 @@
+#include "../include/intern.h"
+#include "../include/memory.h"
+
+#include <string.h>
+#include <threads.h>
+
+#define INITIAL_CAPACITY 256
+#define MAX_LOAD_FACTOR(capacity) ((capacity) / 4 * 3)
+#define CACHE_SIZE 1024
+
+typedef struct {
+    uint32_t hash;
+    intern_id_t id;
+} intern_entry_t;
+
+typedef struct {
+    arena_t* arena;
+
+    // Open addressing with linear probing, power of two capacity.
+    intern_entry_t* entries;
+    size_t capacity;
+
+    string_view_t* names;
+    size_t count;
+
+    mtx_t lock;
+} intern_pool_t;
+
+static intern_pool_t pool = {0};
+static once_flag pool_once = ONCE_FLAG_INIT;
+
+// Per thread, direct mapped on the hash. Hits don't take the pool lock,
+// the names it points to are never moved.
+typedef struct {
+    uint32_t hash;
+    intern_id_t id;
+    string_view_t name;
+} intern_cache_entry_t;
+
+static _Thread_local intern_cache_entry_t cache[CACHE_SIZE];
+
+static inline uint32_t hash_name(string_view_t name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < name.count; i++) {
+        hash ^= (unsigned char)name.data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static void init_pool() {
+    pool.arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE);
+    pool.capacity = INITIAL_CAPACITY;
+    pool.entries = ARENA_MALLOC(pool.arena, intern_entry_t*, sizeof(intern_entry_t) * pool.capacity);
+    pool.names = ARENA_MALLOC(pool.arena, string_view_t*, sizeof(string_view_t) * pool.capacity);
+
+    for(size_t i = 0; i < pool.capacity; i++) {
+        pool.entries[i].id = INTERN_INVALID_ID;
+    }
+
+    mtx_init(&pool.lock, mtx_plain);
+}
+
+static inline intern_entry_t* find_entry(intern_entry_t* entries, size_t capacity,
+                                         string_view_t name, uint32_t hash) {
+    const size_t mask = capacity - 1;
+
+    for(size_t i = hash & mask; ; i = (i + 1) & mask) {
+        intern_entry_t* const entry = &entries[i];
+
+        if(entry->id == INTERN_INVALID_ID) return entry;
+
+        if(entry->hash == hash) {
+            const string_view_t candidate = pool.names[entry->id];
+            if(candidate.count == name.count &&
+               memcmp(candidate.data, name.data, name.count) == 0) {
+                return entry;
+            }
+        }
+    }
+}
+
+static void grow_pool() {
+    const size_t capacity = pool.capacity * 2;
+    intern_entry_t* const entries = ARENA_MALLOC(pool.arena, intern_entry_t*,
+                                                 sizeof(intern_entry_t) * capacity);
+    for(size_t i = 0; i < capacity; i++) {
+        entries[i].id = INTERN_INVALID_ID;
+    }
+
+    for(size_t i = 0; i < pool.capacity; i++) {
+        const intern_entry_t* const entry = &pool.entries[i];
+        if(entry->id == INTERN_INVALID_ID) continue;
+
+        *find_entry(entries, capacity, pool.names[entry->id], entry->hash) = *entry;
+    }
+
+    // The names array never holds more than MAX_LOAD_FACTOR(capacity) entries.
+    string_view_t* const names = ARENA_MALLOC(pool.arena, string_view_t*,
+                                              sizeof(string_view_t) * capacity);
+    memcpy(names, pool.names, sizeof(string_view_t) * pool.count);
+
+    pool.entries = entries;
+    pool.names = names;
+    pool.capacity = capacity;
+}
+
+static intern_id_t intern_locked(string_view_t name, uint32_t hash) {
+    intern_entry_t* entry = find_entry(pool.entries, pool.capacity, name, hash);
+
+    if(entry->id != INTERN_INVALID_ID) {
+        return entry->id;
+    }
+
+    if(pool.count + 1 > MAX_LOAD_FACTOR(pool.capacity)) {
+        grow_pool();
+        entry = find_entry(pool.entries, pool.capacity, name, hash);
+    }
+
+    char* const data = ARENA_MALLOC(pool.arena, char*, name.count + 1);
+    memcpy(data, name.data, name.count);
+
+    entry->hash = hash;
+    entry->id = (intern_id_t)pool.count;
+    pool.names[pool.count++] = new_string_view(data, name.count);
+
+    return entry->id;
+}
+
+intern_id_t intern(string_view_t name) {
+    const uint32_t hash = hash_name(name);
+
+    intern_cache_entry_t* const cached = &cache[hash & (CACHE_SIZE - 1)];
+    if(cached->hash == hash && cached->name.count == name.count &&
+       memcmp(cached->name.data, name.data, name.count) == 0) {
+        return cached->id;
+    }
+
+    call_once(&pool_once, init_pool);
+
+    mtx_lock(&pool.lock);
+    const intern_id_t id = intern_locked(name, hash);
+    const string_view_t interned = pool.names[id];
+    mtx_unlock(&pool.lock);
+
+    *cached = (intern_cache_entry_t) {
+        .hash = hash,
+        .id = id,
+        .name = interned
+    };
+
+    return id;
+}
+
+inline string_view_t interned_name(intern_id_t id) {
+    return pool.names[id];
+}
+
+inline size_t interned_count() {
+    return pool.count;
+}
@@ -0,0 +1,137 @@
+#include "../include/layout.h"
+#include "../include/memory.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Scalars are aligned on their size, `integer` and `float` being `i64` and
+// `f32`. Arrays are aligned like their elements, bool arrays are packed one
+// bit per element. Returns false when the size overflows.
+static bool type_storage(const type_t* type, uint64_t* size, uint32_t* alignment) {
+    const bool is_array = IS_ARRAY(type);
+    uint64_t count = 1;
+
+    for(; IS_ARRAY(type); type = type->underlying) {
+        if(type->length < 0 || __builtin_mul_overflow(count, (uint64_t)type->length, &count)) {
+            return false;
+        }
+    }
+
+    *alignment = type->size;
+
+    if(is_array && are_types_equal(type, bool_type)) {
+        *size = count / 8 + (count % 8 != 0);
+        return true;
+    }
+
+    return !__builtin_mul_overflow(count, (uint64_t)*alignment, size);
+}
+
+// Before the offsets are assigned, `offset` holds the declaration index:
+// `qsort` isn't stable, equal alignments keep the program order this way.
+static int compare_entries(const void* a, const void* b) {
+    const layout_entry_t* const x = a;
+    const layout_entry_t* const y = b;
+
+    if(x->alignment != y->alignment) {
+        return x->alignment > y->alignment ? -1 : 1;
+    }
+
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Rounds `offset` up to `alignment`, a power of two.
+static inline bool align_offset(uint64_t* offset, uint64_t alignment) {
+    uint64_t end;
+    if(__builtin_add_overflow(*offset, alignment - 1, &end)) return false;
+
+    *offset = end & ~(alignment - 1);
+    return true;
+}
+
+bool plan_layout(const ast_node_t* program, data_layout_t* layout) {
+    uint32_t count = 0;
+    for(const ast_node_t* it = program; it != NULL; it = it->next) {
+        count += (it->kind == VARIABLE_DECL_NODE);
+    }
+
+    layout_entry_t* const entries = MALLOC(layout_entry_t*, sizeof(layout_entry_t) * count);
+    bool is_valid = true;
+
+    count = 0;
+    for(const ast_node_t* it = program; it != NULL; it = it->next) {
+        if(it->kind != VARIABLE_DECL_NODE) continue;
+
+        const variable_decl_t* const decl = (variable_decl_t*)it;
+        const type_t* const type = decl->is_type_inferred
+            ? (decl->rvalue != NULL ? decl->rvalue->type : NULL)
+            : decl->type;
+        if(type == NULL) continue;
+
+        layout_entry_t* const entry = &entries[count];
+        entry->decl = decl;
+        entry->type = type;
+        entry->offset = count;
+
+        if(!type_storage(type, &entry->size, &entry->alignment)) {
+            fprintf(stderr, "layout: Variable '"STRING_VIEW_FORMAT"' is too large.\n",
+                    STRING_VIEW_ARG(interned_name(decl->name.id)));
+
+            is_valid = false;
+            continue;
+        }
+
+        count++;
+    }
+
+    layout->entries = entries;
+    layout->count = count;
+    layout->used = 0;
+    layout->size = 0;
+
+    if(!is_valid) return false;
+
+    qsort(entries, count, sizeof(layout_entry_t), compare_entries);
+
+    uint64_t offset = 0;
+    for(uint32_t i = 0; i < count && is_valid; i++) {
+        layout_entry_t* const entry = &entries[i];
+
+        is_valid = align_offset(&offset, entry->alignment);
+        if(!is_valid) break;
+
+        entry->offset = offset;
+        ((variable_decl_t*)entry->decl)->offset = offset;
+
+        is_valid = !__builtin_add_overflow(offset, entry->size, &offset);
+    }
+
+    layout->used = offset;
+    layout->size = offset;
+
+    if(!is_valid || !align_offset(&layout->size, LAYOUT_SEGMENT_ALIGNMENT)) {
+        fprintf(stderr, "layout: The data segment is too large.\n");
+        return false;
+    }
+
+    return true;
+}
+
+void print_layout(const data_layout_t* layout) {
+    printf("Data segment: %" PRIu64 " bytes, %d-byte aligned, %" PRIu64 " bytes of padding.\n",
+           layout->size, LAYOUT_SEGMENT_ALIGNMENT, layout->size - layout->used);
+
+    printf("%12s %12s %6s  %s\n", "offset", "size", "align", "variable");
+
+    for(uint32_t i = 0; i < layout->count; i++) {
+        const layout_entry_t* const entry = &layout->entries[i];
+
+        printf("%12" PRIu64 " %12" PRIu64 " %6u  "STRING_VIEW_FORMAT" ",
+               entry->offset, entry->size, entry->alignment,
+               STRING_VIEW_ARG(interned_name(entry->decl->name.id)));
+
+        print_type(entry->type);
+        putchar('\n');
+    }
+}
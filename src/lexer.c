@@ -1,158 +1,323 @@
 #include "../include/lexer.h"
+#include "../include/scan.h"
+#include "../include/memory.h"
 
 #include <stdbool.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef enum {
+    CHAR_OTHER = 0,
+    CHAR_END,
+    CHAR_BLANK,
+    CHAR_COMMENT,
+    CHAR_DIGIT,
+    CHAR_ALPHA,
+    CHAR_SINGLE,
+    CHAR_COMPARISON
+} char_class_t;
+
+static const uint8_t char_classes[256] = {
+    ['\0'] = CHAR_END,
+    [' '] = CHAR_BLANK, ['\t'] = CHAR_BLANK, ['\r'] = CHAR_BLANK, ['\n'] = CHAR_BLANK,
+    ['#'] = CHAR_COMMENT,
+    ['<'] = CHAR_COMPARISON, ['>'] = CHAR_COMPARISON,
+    ['+'] = CHAR_SINGLE, ['-'] = CHAR_SINGLE, ['*'] = CHAR_SINGLE, ['/'] = CHAR_SINGLE,
+    ['='] = CHAR_SINGLE, [','] = CHAR_SINGLE, [';'] = CHAR_SINGLE,
+    ['('] = CHAR_SINGLE, [')'] = CHAR_SINGLE, ['['] = CHAR_SINGLE, [']'] = CHAR_SINGLE,
+    ['{'] = CHAR_SINGLE, ['}'] = CHAR_SINGLE,
+    ['0'] = CHAR_DIGIT, ['1'] = CHAR_DIGIT, ['2'] = CHAR_DIGIT, ['3'] = CHAR_DIGIT, ['4'] = CHAR_DIGIT,
+    ['5'] = CHAR_DIGIT, ['6'] = CHAR_DIGIT, ['7'] = CHAR_DIGIT, ['8'] = CHAR_DIGIT, ['9'] = CHAR_DIGIT,
+    ['a'] = CHAR_ALPHA, ['b'] = CHAR_ALPHA, ['c'] = CHAR_ALPHA, ['d'] = CHAR_ALPHA, ['e'] = CHAR_ALPHA, ['f'] = CHAR_ALPHA,
+    ['g'] = CHAR_ALPHA, ['h'] = CHAR_ALPHA, ['i'] = CHAR_ALPHA, ['j'] = CHAR_ALPHA, ['k'] = CHAR_ALPHA, ['l'] = CHAR_ALPHA,
+    ['m'] = CHAR_ALPHA, ['n'] = CHAR_ALPHA, ['o'] = CHAR_ALPHA, ['p'] = CHAR_ALPHA, ['q'] = CHAR_ALPHA, ['r'] = CHAR_ALPHA,
+    ['s'] = CHAR_ALPHA, ['t'] = CHAR_ALPHA, ['u'] = CHAR_ALPHA, ['v'] = CHAR_ALPHA, ['w'] = CHAR_ALPHA, ['x'] = CHAR_ALPHA,
+    ['y'] = CHAR_ALPHA, ['z'] = CHAR_ALPHA,
+    ['A'] = CHAR_ALPHA, ['B'] = CHAR_ALPHA, ['C'] = CHAR_ALPHA, ['D'] = CHAR_ALPHA, ['E'] = CHAR_ALPHA, ['F'] = CHAR_ALPHA,
+    ['G'] = CHAR_ALPHA, ['H'] = CHAR_ALPHA, ['I'] = CHAR_ALPHA, ['J'] = CHAR_ALPHA, ['K'] = CHAR_ALPHA, ['L'] = CHAR_ALPHA,
+    ['M'] = CHAR_ALPHA, ['N'] = CHAR_ALPHA, ['O'] = CHAR_ALPHA, ['P'] = CHAR_ALPHA, ['Q'] = CHAR_ALPHA, ['R'] = CHAR_ALPHA,
+    ['S'] = CHAR_ALPHA, ['T'] = CHAR_ALPHA, ['U'] = CHAR_ALPHA, ['V'] = CHAR_ALPHA, ['W'] = CHAR_ALPHA, ['X'] = CHAR_ALPHA,
+    ['Y'] = CHAR_ALPHA, ['Z'] = CHAR_ALPHA,
+};
+
+static const uint8_t single_char_tokens[256] = {
+    ['+'] = PLUS, ['-'] = MINUS, ['*'] = STAR, ['/'] = SLASH,
+    ['='] = ASSIGN, [','] = COMMA, [';'] = SEMICOLON,
+    ['('] = LEFT_PAREN, [')'] = RIGHT_PAREN,
+    ['['] = LEFT_BRACKET, [']'] = RIGHT_BRACKET,
+    ['{'] = LEFT_BRACE, ['}'] = RIGHT_BRACE
+};
+
+#define CHAR_CLASS(c) (char_classes[(unsigned char)(c)])
+
+static const char* token_spellings[] = {
+    [PLUS] = "+", [MINUS] = "-", [STAR] = "*", [SLASH] = "/",
+    [LESS] = "<", [ASSIGN] = "=", [COMMA] = ",", [SEMICOLON] = ";",
+    [GREATER] = ">", [GREATER_EQ] = ">=", [LESS_EQ] = "<=",
+    [LEFT_BRACKET] = "[", [RIGHT_BRACKET] = "]",
+    [LEFT_BRACE] = "{", [RIGHT_BRACE] = "}",
+    [LEFT_PAREN] = "(", [RIGHT_PAREN] = ")",
+    [TRUE_KEYWORD] = "true", [FALSE_KEYWORD] = "false",
+    [LET_KEYWORD] = "let", [VAR_KEYWORD] = "var", [AS_KEYWORD] = "as",
+    [IF_KEYWORD] = "if", [ELSE_KEYWORD] = "else", [THEN_KEYWORD] = "then",
+    [FLOAT_KEYWORD] = "float", [INTEGER_KEYWORD] = "integer", [BOOL_KEYWORD] = "bool",
+    [I8_KEYWORD] = "i8", [I16_KEYWORD] = "i16", [I32_KEYWORD] = "i32", [I64_KEYWORD] = "i64",
+    [F32_KEYWORD] = "f32", [F64_KEYWORD] = "f64",
+    [TOK_SUSPEND] = NULL
+};
+
+inline const char* token_spelling(token_type_t type) {
+    return token_spellings[type];
+}
 
 static inline token_t make_token(const lexer_t* restrict lex, int type) {
-    const int length = lex->current - lex->start;
+    if(!lex->is_final && lex->current >= string_view_size(lex->source)) {
+        type = TOK_SUSPEND;
+    }
+
     return (token_t) {
-        .line = lex->line,
-        .type = type,
-        .lexeme = string_view_substr(lex->source, lex->start, length)
+        .start = lex->start,
+        .length = lex->current - lex->start,
+        .id = INTERN_INVALID_ID,
+        .type = type
     };
 }
 
-static inline bool is_at_end(const lexer_t* restrict lex) {
-    return lex->current >= (int)string_view_size(lex->source);
-}
+// Runs shorter than this are scanned with the class table, longer ones are
+// handed to the vector kernels.
+#define SHORT_RUN 8
 
-static inline char lex_peek(const lexer_t* restrict lex) {
-    return string_view_at(lex->source, lex->current);
-}
+static inline const char* skip_class(const char* p, char_class_t class,
+                                     const char* (*kernel)(const char*)) {
+    for(int i = 0; i < SHORT_RUN; i++, p++) {
+        if(CHAR_CLASS(*p) != class) return p;
+    }
 
-static inline char lex_advance(lexer_t* restrict lex) {
-    const char c = lex_peek(lex);
-    return !is_at_end(lex)
-        ? (lex->current++, c)
-        : '\0';
+    return kernel(p);
 }
 
-static inline bool match(lexer_t* restrict lex, char c) {
-    return (lex_peek(lex) == c)
-        ? (lex_advance(lex), true)
-        : false;
+// Identifiers start with a letter, digits may follow.
+static inline const char* skip_identifier(const char* p) {
+    for(int i = 0; i < SHORT_RUN; i++, p++) {
+        const char_class_t class = CHAR_CLASS(*p);
+        if(class != CHAR_ALPHA && class != CHAR_DIGIT) return p;
+    }
+
+    return scan.skip_alnum(p);
 }
 
+// The source is NUL terminated, so the scans stop at the sentinel without
+// checking the length.
 static void skip_whitespaces(lexer_t* restrict lex) {
-    while(!is_at_end(lex)) {
-        switch(lex_peek(lex)) {
-            case '#':
-                // single line comment
-                while(lex_peek(lex) != '\n' && !is_at_end(lex)) {
-                    lex_advance(lex);
+    const char* const src = string_view_data(lex->source);
+    const char* p = src + lex->current;
+
+    for(;;) {
+        switch(CHAR_CLASS(*p)) {
+            case CHAR_BLANK:
+                // Tokens are mostly separated by a single space.
+                if(*p == ' ' && CHAR_CLASS(p[1]) != CHAR_BLANK) {
+                    p++;
+                } else {
+                    p = scan.skip_blanks(p);
                 }
-            case '\n':
-                lex->line++;
-            case ' ':
-            case '\r':
-            case '\t':
+                break;
+            case CHAR_COMMENT:
+                // single line comment
+                p = scan.find_line_end(p);
                 break;
             default:
+                lex->current = p - src;
                 return;
         }
+    }
+}
+
+#define KEYWORD(str, length, kw, type) \
+    ((sizeof(kw) - 1 == (length) && memcmp((str), (kw), sizeof(kw) - 1) == 0) ? (type) : IDENTIFIER)
 
-        lex_advance(lex);
+// Dispatch on length and first character, so at most one memcmp is needed.
+static inline token_type_t keyword_type(const char* restrict str, size_t length) {
+    switch(length) {
+        case 2:
+            switch(str[0]) {
+                case 'a': return KEYWORD(str, length, "as", AS_KEYWORD);
+                case 'i':
+                    return str[1] == 'f'
+                        ? KEYWORD(str, length, "if", IF_KEYWORD)
+                        : KEYWORD(str, length, "i8", I8_KEYWORD);
+            }
+            break;
+        case 3:
+            switch(str[0]) {
+                case 'l': return KEYWORD(str, length, "let", LET_KEYWORD);
+                case 'v': return KEYWORD(str, length, "var", VAR_KEYWORD);
+                case 'i':
+                    switch(str[1]) {
+                        case '1': return KEYWORD(str, length, "i16", I16_KEYWORD);
+                        case '3': return KEYWORD(str, length, "i32", I32_KEYWORD);
+                        case '6': return KEYWORD(str, length, "i64", I64_KEYWORD);
+                    }
+                    break;
+                case 'f':
+                    switch(str[1]) {
+                        case '3': return KEYWORD(str, length, "f32", F32_KEYWORD);
+                        case '6': return KEYWORD(str, length, "f64", F64_KEYWORD);
+                    }
+                    break;
+            }
+            break;
+        case 4:
+            switch(str[0]) {
+                case 'b': return KEYWORD(str, length, "bool", BOOL_KEYWORD);
+                case 'e': return KEYWORD(str, length, "else", ELSE_KEYWORD);
+                case 't':
+                    return str[1] == 'h'
+                        ? KEYWORD(str, length, "then", THEN_KEYWORD)
+                        : KEYWORD(str, length, "true", TRUE_KEYWORD);
+            }
+            break;
+        case 5:
+            switch(str[0]) {
+                case 'f':
+                    return str[1] == 'a'
+                        ? KEYWORD(str, length, "false", FALSE_KEYWORD)
+                        : KEYWORD(str, length, "float", FLOAT_KEYWORD);
+            }
+            break;
+        case 7:
+            return KEYWORD(str, length, "integer", INTEGER_KEYWORD);
     }
+
+    return IDENTIFIER;
 }
 
+#undef KEYWORD
+
 token_t next_token(lexer_t* restrict lex) {
 
     skip_whitespaces(lex);
     lex->start = lex->current;
 
-    const char c = lex_advance(lex);
+    const char* const src = string_view_data(lex->source);
+    int current = lex->current;
+    const char c = src[current];
 
-    switch(c) {
-        case '\0':
+    switch(CHAR_CLASS(c)) {
+        case CHAR_END:
             return make_token(lex, TOK_EOF);
-        case '+':
-            return make_token(lex, PLUS);
-        case '-':
-            return make_token(lex, MINUS);
-        case '/':
-            return make_token(lex, SLASH);
-        case '*':
-            return make_token(lex, STAR);
-        case '=':
-            return make_token(lex, ASSIGN);
-        case ',':
-            return make_token(lex, COMMA);
-        case ';':
-            return make_token(lex, SEMICOLON);
-        case '(':
-            return make_token(lex, LEFT_PAREN);
-        case ')':
-            return make_token(lex, RIGHT_PAREN);
-        case '[':
-            return make_token(lex, LEFT_BRACKET);
-        case ']':
-            return make_token(lex, RIGHT_BRACKET);
-        case '{':
-            return make_token(lex, LEFT_BRACE);
-        case '}':
-            return make_token(lex, RIGHT_BRACE);
-        case '>':
-            return make_token(lex, match(lex, '=') ? GREATER_EQ : GREATER);
-        case '<':
-            return make_token(lex, match(lex, '=') ? LESS_EQ : LESS);
-        default: {
-
-            if(isdigit(c)) {
-
-                token_type_t type = INTEGER_LITERAL;
-                while(isdigit(lex_peek(lex)) && !is_at_end(lex)) {
-                    lex_advance(lex);
-                }
+        case CHAR_SINGLE:
+            lex->current = current + 1;
+            return make_token(lex, single_char_tokens[(unsigned char)c]);
+        case CHAR_COMPARISON: {
+            const bool has_equal = src[current + 1] == '=';
+            lex->current = current + 1 + has_equal;
 
-                if(match(lex, '.') && isdigit(lex_peek(lex))) {
-                    type = FLOATING_LITERAL;
-                    while(isdigit(lex_peek(lex)) && !is_at_end(lex)) {
-                        lex_advance(lex);
-                    }
-                }
+            if(c == '<') {
+                return make_token(lex, has_equal ? LESS_EQ : LESS);
+            }
 
-                return make_token(lex, type);
+            return make_token(lex, has_equal ? GREATER_EQ : GREATER);
+        }
+        case CHAR_DIGIT: {
+
+            token_type_t type = INTEGER_LITERAL;
+            current = skip_class(src + current + 1, CHAR_DIGIT, scan.skip_digits) - src;
+
+            if(src[current] == '.' && CHAR_CLASS(src[++current]) == CHAR_DIGIT) {
+                type = FLOATING_LITERAL;
+                current = skip_class(src + current + 1, CHAR_DIGIT, scan.skip_digits) - src;
             }
 
-            if(isalpha(c)) {
-                while(isalpha(lex_peek(lex)) && !is_at_end(lex)) {
-                    lex_advance(lex);
-                }
+            lex->current = current;
+            return make_token(lex, type);
+        }
+        case CHAR_ALPHA: {
 
-                const string_view_t lexeme = string_view_substr(lex->source,
-                                                                lex->start,
-                                                                lex->current - lex->start);
-                token_type_t type = IDENTIFIER;
-                if(string_view_equal(lexeme, new_string_view_from_cstr("var"))) {
-                    type = VAR_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("as"))) {
-                    type = AS_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("let"))) {
-                    type = LET_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("true"))) {
-                    type = TRUE_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("false"))) {
-                    type = FALSE_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("if"))) {
-                    type = IF_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("then"))) {
-                    type = THEN_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("else"))) {
-                    type = ELSE_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("float"))) {
-                    type = FLOAT_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("integer"))) {
-                    type = INTEGER_KEYWORD;
-                } else if(string_view_equal(lexeme, new_string_view_from_cstr("bool"))) {
-                    type = BOOL_KEYWORD;
-                }
+            current = skip_identifier(src + current + 1) - src;
+            lex->current = current;
+
+            const token_type_t type = keyword_type(src + lex->start, current - lex->start);
 
-                return make_token(lex, type);
+            token_t token = make_token(lex, type);
+            if(token.type == IDENTIFIER) {
+                token.id = intern(new_string_view(src + token.start, token.length));
             }
 
-            break;
+            return token;
         }
+        default:
+            break;
     }
-    
+
+    lex->current = current + 1;
     return make_token(lex, TOK_ERR);
 }
+
+// =============== Token buffer ===============
+
+// Rough guess of the number of tokens, to avoid most of the regrowths.
+#define ESTIMATED_TOKENS(size) ((size) / 4 + 16)
+
+static void grow_token_buffer(token_buffer_t* tokens, size_t capacity) {
+    uint8_t* const types = MALLOC(uint8_t*, sizeof(uint8_t) * capacity);
+    uint32_t* const starts = MALLOC(uint32_t*, sizeof(uint32_t) * capacity);
+    uint32_t* const lengths = MALLOC(uint32_t*, sizeof(uint32_t) * capacity);
+    intern_id_t* const ids = MALLOC(intern_id_t*, sizeof(intern_id_t) * capacity);
+
+    if(tokens->count > 0) {
+        memcpy(types, tokens->types, sizeof(uint8_t) * tokens->count);
+        memcpy(starts, tokens->starts, sizeof(uint32_t) * tokens->count);
+        memcpy(lengths, tokens->lengths, sizeof(uint32_t) * tokens->count);
+        memcpy(ids, tokens->ids, sizeof(intern_id_t) * tokens->count);
+    }
+
+    tokens->types = types;
+    tokens->starts = starts;
+    tokens->lengths = lengths;
+    tokens->ids = ids;
+    tokens->capacity = capacity;
+}
+
+token_buffer_t tokenize(string_view_t source) {
+    token_buffer_t tokens = {
+        .source = source,
+        .count = 0,
+        .capacity = 0
+    };
+
+    grow_token_buffer(&tokens, ESTIMATED_TOKENS(string_view_size(source)));
+
+    lexer_t lex = INIT_LEXER(source);
+
+    for(;;) {
+        const token_t token = next_token(&lex);
+
+        if(tokens.count == tokens.capacity) {
+            grow_token_buffer(&tokens, tokens.capacity * 2);
+        }
+
+        const size_t i = tokens.count++;
+        tokens.types[i] = token.type;
+        tokens.starts[i] = token.start;
+        tokens.lengths[i] = token.length;
+        tokens.ids[i] = token.id;
+
+        if(token.type == TOK_EOF || token.type == TOK_ERR) {
+            break;
+        }
+    }
+
+    return tokens;
+}
+
+#undef ESTIMATED_TOKENS
+
+inline token_t token_buffer_get(const token_buffer_t* tokens, size_t index) {
+    return (token_t) {
+        .start = tokens->starts[index],
+        .length = tokens->lengths[index],
+        .id = tokens->ids[index],
+        .type = tokens->types[index]
+    };
+}
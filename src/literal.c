@@ -0,0 +1,378 @@
+#include "../include/literal.h"
+
+#include <float.h>
+#include <string.h>
+
+bool parse_integer_literal(string_view_t lexeme, int64_t* value) {
+    const char* const data = string_view_data(lexeme);
+    const size_t length = string_view_size(lexeme);
+
+    int64_t result = 0;
+
+    for(size_t i = 0; i < length; i++) {
+        if(__builtin_mul_overflow(result, 10, &result) ||
+           __builtin_add_overflow(result, data[i] - '0', &result)) {
+            return false;
+        }
+    }
+
+    *value = result;
+    return true;
+}
+
+// Powers of ten a float, or a double, holds exactly.
+static const float float_powers[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double double_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define FLOAT_POWERS_MAX ((int64_t)(sizeof(float_powers) / sizeof(float_powers[0])) - 1)
+#define DOUBLE_POWERS_MAX ((int64_t)(sizeof(double_powers) / sizeof(double_powers[0])) - 1)
+
+// Digits an uint64_t always holds.
+#define MANTISSA_DIGITS 19
+
+// A value halfway between two floats has at most 112 significant digits,
+// past them the digits only matter by not all being zeros.
+#define SIGNIFICANT_DIGITS 120
+
+// Rounding such a double again, to a float, may not give the nearest float.
+static inline bool is_float_halfway(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // The 29 bits a float doesn't have are 1 followed by zeros.
+    return (bits & 0x1FFFFFFF) == 0x10000000;
+}
+
+// =============== Slow path ===============
+
+// Unsigned integer of up to BIG_LIMBS * 32 bits, least significant limb
+// first. The largest ones compared are the 121 digits times 2^150, and a
+// float halfway point times 10^167, about 600 bits.
+#define BIG_LIMBS 40
+
+typedef struct {
+    uint32_t limbs[BIG_LIMBS];
+    int count;
+} big_t;
+
+static inline void big_set(big_t* big, uint32_t value) {
+    big->limbs[0] = value;
+    big->count = value != 0;
+}
+
+static void big_mul_add(big_t* big, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+
+    for(int i = 0; i < big->count; i++) {
+        const uint64_t product = (uint64_t)big->limbs[i] * factor + carry;
+
+        big->limbs[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+
+    if(carry != 0) {
+        big->limbs[big->count++] = (uint32_t)carry;
+    }
+}
+
+static void big_mul_pow10(big_t* big, int exponent) {
+    for(; exponent >= 9; exponent -= 9) {
+        big_mul_add(big, 1000000000, 0);
+    }
+
+    static const uint32_t powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    big_mul_add(big, powers[exponent], 0);
+}
+
+static void big_shift_left(big_t* big, int shift) {
+    if(big->count == 0) return;
+
+    const int limbs = shift / 32;
+    const int bits = shift % 32;
+
+    if(bits != 0) {
+        uint32_t carry = 0;
+
+        for(int i = 0; i < big->count; i++) {
+            const uint32_t limb = big->limbs[i];
+
+            big->limbs[i] = (limb << bits) | carry;
+            carry = limb >> (32 - bits);
+        }
+
+        if(carry != 0) {
+            big->limbs[big->count++] = carry;
+        }
+    }
+
+    if(limbs != 0) {
+        memmove(big->limbs + limbs, big->limbs, sizeof(uint32_t) * big->count);
+        memset(big->limbs, 0, sizeof(uint32_t) * limbs);
+        big->count += limbs;
+    }
+}
+
+static int big_compare(const big_t* a, const big_t* b) {
+    if(a->count != b->count) return a->count < b->count ? -1 : 1;
+
+    for(int i = a->count - 1; i >= 0; i--) {
+        if(a->limbs[i] != b->limbs[i]) return a->limbs[i] < b->limbs[i] ? -1 : 1;
+    }
+
+    return 0;
+}
+
+// A finite non-negative float, `mantissa` * 2^exponent. Normal ones have
+// 24 bits of mantissa, subnormals and 0 have the smallest exponent.
+typedef struct {
+    uint32_t mantissa;
+    int exponent;
+} binary_float_t;
+
+#define FLOAT_MIN_EXPONENT (FLT_MIN_EXP - FLT_MANT_DIG)
+#define FLOAT_MAX_EXPONENT (FLT_MAX_EXP - FLT_MANT_DIG)
+#define FLOAT_HIDDEN_BIT (UINT32_C(1) << (FLT_MANT_DIG - 1))
+
+static binary_float_t split_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t biased = bits >> (FLT_MANT_DIG - 1);
+    const uint32_t fraction = bits & (FLOAT_HIDDEN_BIT - 1);
+
+    if(biased == 0) {
+        return (binary_float_t) { .mantissa = fraction, .exponent = FLOAT_MIN_EXPONENT };
+    }
+
+    return (binary_float_t) {
+        .mantissa = fraction | FLOAT_HIDDEN_BIT,
+        .exponent = (int)biased - 1 + FLOAT_MIN_EXPONENT
+    };
+}
+
+static float join_float(binary_float_t f) {
+    const uint32_t biased = f.mantissa >= FLOAT_HIDDEN_BIT ? (uint32_t)(f.exponent - FLOAT_MIN_EXPONENT) + 1 : 0;
+    const uint32_t bits = (biased << (FLT_MANT_DIG - 1)) | (f.mantissa & (FLOAT_HIDDEN_BIT - 1));
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+static binary_float_t next_float(binary_float_t f) {
+    if(++f.mantissa == FLOAT_HIDDEN_BIT << 1) {
+        f.mantissa = FLOAT_HIDDEN_BIT;
+        f.exponent++;
+    }
+
+    return f;
+}
+
+static binary_float_t previous_float(binary_float_t f) {
+    if(--f.mantissa < FLOAT_HIDDEN_BIT && f.exponent > FLOAT_MIN_EXPONENT) {
+        f.mantissa = (FLOAT_HIDDEN_BIT << 1) - 1;
+        f.exponent--;
+    }
+
+    return f;
+}
+
+// Sign of `digits` * 10^exponent - the value halfway between `f` and the
+// next float, (2 * mantissa + 1) * 2^(exponent - 1).
+static int compare_halfway(const big_t* digits, int exponent, binary_float_t f) {
+    big_t value = *digits;
+    big_t halfway;
+    big_set(&halfway, 2 * f.mantissa + 1);
+
+    if(exponent >= 0) {
+        big_mul_pow10(&value, exponent);
+    } else {
+        big_mul_pow10(&halfway, -exponent);
+    }
+
+    if(f.exponent - 1 >= 0) {
+        big_shift_left(&halfway, f.exponent - 1);
+    } else {
+        big_shift_left(&value, 1 - f.exponent);
+    }
+
+    return big_compare(&value, &halfway);
+}
+
+// `value` * 10^scale in doubles, off by a few ulps of a double.
+static double scale_double(double value, int scale) {
+    for(; scale < -DOUBLE_POWERS_MAX; scale += DOUBLE_POWERS_MAX) {
+        value /= double_powers[DOUBLE_POWERS_MAX];
+    }
+
+    for(; scale > DOUBLE_POWERS_MAX; scale -= DOUBLE_POWERS_MAX) {
+        value *= double_powers[DOUBLE_POWERS_MAX];
+    }
+
+    return scale < 0 ? value / double_powers[-scale] : value * double_powers[scale];
+}
+
+// Moves a positive double by `ulps` ulps.
+static inline double nudge_double(double value, int64_t ulps) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    bits += (uint64_t)ulps;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+// Rounds `digits` * 10^exponent to the nearest float, ties to even.
+// `mantissa` holds the first MANTISSA_DIGITS of them, so the value is between
+// it and the next integer, times a power of ten. When both bounds, widened
+// by the errors of the doubles, round to the same float, that's the one.
+// Otherwise the guess, off by at most an ulp of a float, moves to the
+// neighbour while the value is past the halfway point to it, comparing
+// exactly (Clinger's algorithm R on big integers).
+static bool round_slow(const char* digits, int count, int exponent, uint64_t mantissa, float* value) {
+    // The value is under 10^(count + exponent). From 10^39 it's past FLT_MAX,
+    // under 10^-46 it's nearer to 0 than to the smallest subnormal, 1.4e-45.
+    if(count + exponent > 39) return false;
+
+    if(count + exponent < -46) {
+        *value = 0.0f;
+        return true;
+    }
+
+    const int scale = exponent + (count > MANTISSA_DIGITS ? count - MANTISSA_DIGITS : 0);
+    const double guess = scale_double((double)mantissa, scale);
+    const double upper = count > MANTISSA_DIGITS ? scale_double((double)(mantissa + 1), scale) : guess;
+
+    if(upper < FLT_MAX) {
+        const float low = (float)nudge_double(guess, -16);
+
+        if(low == (float)nudge_double(upper, 16)) {
+            *value = low;
+            return true;
+        }
+    }
+
+    binary_float_t f = guess < FLT_MAX
+        ? split_float((float)guess)
+        : (binary_float_t) { .mantissa = (FLOAT_HIDDEN_BIT << 1) - 1, .exponent = FLOAT_MAX_EXPONENT };
+
+    big_t big = { .count = 0 };
+    for(int i = 0; i < count; i++) {
+        big_mul_add(&big, 10, (uint32_t)(digits[i] - '0'));
+    }
+
+    for(;;) {
+        const int above = compare_halfway(&big, exponent, f);
+
+        if(above > 0 || (above == 0 && (f.mantissa & 1) != 0)) {
+            f = next_float(f);
+            if(f.exponent > FLOAT_MAX_EXPONENT) return false;
+
+            continue;
+        }
+
+        if(f.mantissa == 0) break;
+
+        const binary_float_t previous = previous_float(f);
+        const int below = compare_halfway(&big, exponent, previous);
+
+        if(below < 0 || (below == 0 && (f.mantissa & 1) != 0)) {
+            f = previous;
+            continue;
+        }
+
+        break;
+    }
+
+    *value = join_float(f);
+    return true;
+}
+
+// =============== Literals ===============
+
+// When the digits and the power of ten are exact floats, or doubles, a single
+// division rounds correctly. The other values are rounded on big integers.
+bool parse_float_literal(string_view_t lexeme, float* value) {
+    const char* const data = string_view_data(lexeme);
+    const size_t length = string_view_size(lexeme);
+
+    // The value is `digits` * 10^exponent, without the leading zeros. The
+    // first MANTISSA_DIGITS of them are also in `mantissa`.
+    char digits[SIGNIFICANT_DIGITS + 1];
+    int count = 0;
+    int64_t exponent = 0;
+    uint64_t mantissa = 0;
+
+    bool is_fraction = false;
+    bool is_truncated = false;
+
+    for(size_t i = 0; i < length; i++) {
+        const char c = data[i];
+
+        if(c == '.') {
+            is_fraction = true;
+        } else if(count == 0 && c == '0') {
+            exponent -= is_fraction;
+        } else if(count < SIGNIFICANT_DIGITS) {
+            if(count < MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            }
+
+            digits[count++] = c;
+            exponent -= is_fraction;
+        } else {
+            is_truncated |= c != '0';
+            exponent += !is_fraction;
+        }
+    }
+
+    if(count == 0) {
+        *value = 0.0f;
+        return true;
+    }
+
+    if(count <= MANTISSA_DIGITS && exponent <= 0) {
+        if(mantissa <= (UINT64_C(1) << FLT_MANT_DIG) && -exponent <= FLOAT_POWERS_MAX) {
+            *value = (float)mantissa / float_powers[-exponent];
+            return true;
+        }
+
+        if(mantissa <= (UINT64_C(1) << DBL_MANT_DIG) && -exponent <= DOUBLE_POWERS_MAX) {
+            const double result = (double)mantissa / double_powers[-exponent];
+
+            if(!is_float_halfway(result)) {
+                *value = (float)result;
+                return true;
+            }
+        }
+    }
+
+    // The dropped digits only break ties, like a last 1 would.
+    if(is_truncated) {
+        digits[count++] = '1';
+        exponent--;
+    }
+
+    // Far out of the float range either way, `round_slow` settles it.
+    if(exponent > INT32_MAX / 2) exponent = INT32_MAX / 2;
+    if(exponent < INT32_MIN / 2) exponent = INT32_MIN / 2;
+
+    return round_slow(digits, count, (int)exponent, mantissa, value);
+}
+
+#undef FLOAT_POWERS_MAX
+#undef DOUBLE_POWERS_MAX
+#undef MANTISSA_DIGITS
+#undef SIGNIFICANT_DIGITS
+#undef BIG_LIMBS
+#undef FLOAT_MIN_EXPONENT
+#undef FLOAT_MAX_EXPONENT
+#undef FLOAT_HIDDEN_BIT
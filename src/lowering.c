@@ -0,0 +1,216 @@
+#include "../include/lowering.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline bool integer_literal(const ast_node_t* node, int64_t* value) {
+    if(node->kind != LITERAL_NODE) return false;
+
+    const literal_expr_t* const lit = (literal_expr_t*)node;
+    if(!are_types_equal(lit->type, int_type)) return false;
+
+    *value = lit->value.integer;
+    return true;
+}
+
+static inline const ast_node_t* make_integer(int64_t value) {
+    ast_node_t* const lit = (ast_node_t*)make_literal_expr(INTEGER_VALUE(value), int_type);
+    lit->type = int_type;
+
+    return lit;
+}
+
+static inline const ast_node_t* make_integer_op(token_type_t op, const ast_node_t* left, const ast_node_t* right) {
+    ast_node_t* const expr = (ast_node_t*)make_binary_expr((token_t) { .type = op }, left, right);
+    expr->type = int_type;
+
+    return expr;
+}
+
+// Subscripts may use any integer type, the offsets are computed on `integer`.
+static const ast_node_t* widen_index(const ast_node_t* index) {
+    if(index->type == NULL || are_types_equal(index->type, int_type)) return index;
+
+    ast_node_t* const expr = (ast_node_t*)make_casting_expr(index, int_type);
+    expr->type = int_type;
+
+    return expr;
+}
+
+// `offset * length + index`, without the steps that do nothing.
+static const ast_node_t* scale_offset(const ast_node_t* offset, int length, const ast_node_t* index) {
+    int64_t a = 0, b = 0;
+    const bool is_offset_constant = integer_literal(offset, &a);
+    const bool is_index_constant = integer_literal(index, &b);
+
+    int64_t product;
+    const bool is_product_constant = is_offset_constant &&
+        !__builtin_mul_overflow(a, (int64_t)length, &product);
+
+    if(is_product_constant && is_index_constant) {
+        int64_t result;
+        if(!__builtin_add_overflow(product, b, &result)) {
+            return make_integer(result);
+        }
+    }
+
+    if(is_product_constant && product == 0) return index;
+
+    const ast_node_t* scaled = offset;
+    if(is_product_constant) {
+        scaled = make_integer(product);
+    } else if(length != 1) {
+        scaled = make_integer_op(STAR, offset, make_integer(length));
+    }
+
+    if(is_index_constant && b == 0) return scaled;
+
+    return make_integer_op(PLUS, scaled, index);
+}
+
+// A chain is in range when all of its subscripts are, out of range when any is.
+static inline bounds_status_t chain_bounds(bounds_status_t prefix, bounds_status_t subscript) {
+    if(prefix == BOUNDS_OUT_OF_RANGE || subscript == BOUNDS_OUT_OF_RANGE) return BOUNDS_OUT_OF_RANGE;
+    if(prefix == BOUNDS_IN_RANGE && subscript == BOUNDS_IN_RANGE) return BOUNDS_IN_RANGE;
+
+    return BOUNDS_UNKNOWN;
+}
+
+// Bool arrays are stored one bit per element. Sets `count` to the number of bools.
+static bool is_packed_array(const type_t* type, uint64_t* count) {
+    if(!IS_ARRAY(type)) return false;
+
+    *count = 1;
+    for(; IS_ARRAY(type); type = type->underlying) {
+        if(type->length < 0 || __builtin_mul_overflow(*count, (uint64_t)type->length, count)) {
+            return false;
+        }
+    }
+
+    return are_types_equal(type, bool_type) && *count <= SIZE_MAX - 7;
+}
+
+typedef struct {
+    // Next element to pack of each initializer being walked, innermost last.
+    const ast_node_t** items;
+    size_t count;
+    size_t capacity;
+} pack_stack_t;
+
+static void push_element(pack_stack_t* stack, const ast_node_t* element) {
+    if(stack->count == stack->capacity) {
+        stack->capacity = stack->capacity != 0 ? stack->capacity * 2 : 64;
+        stack->items = realloc(stack->items, sizeof(const ast_node_t*) * stack->capacity);
+
+        if(stack->items == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    stack->items[stack->count++] = element;
+}
+
+// The `count` bools of an initializer in row-major order, NULL when one of
+// them isn't a literal. The image is allocated from the active arena.
+static const uint8_t* pack_initializer(const initializer_t* initializer, uint64_t count) {
+    arena_t* const arena = active_arena();
+    const arena_mark_t mark = arena_mark(arena);
+
+    uint8_t* const bits = MALLOC(uint8_t*, (size_t)((count + 7) / 8));
+    uint64_t index = 0;
+    bool is_constant = true;
+
+    pack_stack_t stack = {0};
+    push_element(&stack, initializer->init);
+
+    while(stack.count > 0 && is_constant) {
+        const ast_node_t* const element = stack.items[stack.count - 1];
+
+        if(element == NULL) {
+            stack.count--;
+            continue;
+        }
+
+        stack.items[stack.count - 1] = element->next;
+
+        if(element->kind == INITIALIZER_NODE) {
+            push_element(&stack, ((initializer_t*)element)->init);
+            continue;
+        }
+
+        is_constant = element->kind == LITERAL_NODE &&
+                      are_types_equal(((literal_expr_t*)element)->type, bool_type) &&
+                      index < count;
+
+        if(is_constant && ((literal_expr_t*)element)->value.integer != 0) {
+            bits[index / 8] |= (uint8_t)(1u << (index % 8));
+        }
+
+        index++;
+    }
+
+    free(stack.items);
+
+    if(!is_constant || index != count) {
+        arena_rollback(arena, mark);
+        return NULL;
+    }
+
+    return bits;
+}
+
+static const ast_node_t* lower_decl(variable_decl_t* decl, lowering_stats_t* stats) {
+    const ast_node_t* const rvalue = decl->rvalue;
+    if(rvalue == NULL || rvalue->kind != INITIALIZER_NODE || rvalue->type == NULL) return (ast_node_t*)decl;
+
+    uint64_t count;
+    if(!is_packed_array(rvalue->type, &count)) return (ast_node_t*)decl;
+
+    initializer_t* const initializer = (initializer_t*)rvalue;
+    initializer->bits = pack_initializer(initializer, count);
+    initializer->bit_count = count;
+
+    stats->packed_initializers += (initializer->bits != NULL);
+    return (ast_node_t*)decl;
+}
+
+static const ast_node_t* lower_node(const ast_node_t* node, void* context) {
+    lowering_stats_t* const stats = context;
+
+    if(node->kind == VARIABLE_DECL_NODE) return lower_decl((variable_decl_t*)node, stats);
+    if(node->kind != SUBSCRIPT_EXPR_NODE || node->type == NULL) return node;
+
+    const subscript_expr_t* const expr = (subscript_expr_t*)node;
+    element_expr_t* access;
+
+    // The lvalue was lowered first, a chain extends the access of its prefix.
+    if(expr->lvalue->kind == ELEMENT_EXPR_NODE) {
+        const element_expr_t* const prefix = (element_expr_t*)expr->lvalue;
+        const ast_node_t* const offset = scale_offset(prefix->offset, prefix->base.type->length,
+                                                      widen_index(expr->index));
+
+        access = (element_expr_t*)make_element_expr(prefix->array, offset, prefix->dimensions + 1);
+        access->bounds = chain_bounds(prefix->bounds, expr->bounds);
+        access->is_packed = prefix->is_packed;
+    } else {
+        uint64_t count;
+
+        access = (element_expr_t*)make_element_expr(expr->lvalue, widen_index(expr->index), 1);
+        access->bounds = expr->bounds;
+        access->is_packed = expr->lvalue->type != NULL && is_packed_array(expr->lvalue->type, &count);
+
+        stats->accesses++;
+        stats->packed += access->is_packed;
+    }
+
+    access->base.type = node->type;
+    stats->subscripts++;
+
+    return (ast_node_t*)access;
+}
+
+const ast_node_t* lower_ast(const ast_node_t* program, lowering_stats_t* stats) {
+    return rewrite_ast(program, lower_node, stats);
+}
@@ -1,10 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "../include/ast.h"
+#include "../include/lexer.h"
 #include "../include/parser.h"
 #include "../include/memory.h"
 #include "../include/typechecker.h"
+#include "../include/flat_ast.h"
+#include "../include/optimizer.h"
+#include "../include/lowering.h"
+#include "../include/bounds.h"
+#include "../include/layout.h"
+#include "../include/source.h"
+#include "../include/scan.h"
 
 
 /*
@@ -12,7 +22,7 @@
 
   declaration: variable-decl | statement
 
-  type-expr: ('float' | 'integer' | 'bool') ('[' INTEGER ']')*
+  type-expr: ('float' | 'integer' | 'bool' | 'i8' | 'i16' | 'i32' | 'i64' | 'f32' | 'f64') ('[' INTEGER ']')*
 
   initializer: expression | '{' initializer (',' initializer)* '}'
   variable-decl: ('let' | 'var') IDENTIFIER type-expr? ('=' initializer)? ';'
@@ -33,44 +43,245 @@
   
 */
 
-static char* read_from_file(const char* const restrict file) {
+#define STREAM_CHUNK_SIZE (64 * 1024)
 
-    FILE* const stream = fopen(file, "r");
+// Parses the input while it is being read, declaration by declaration. With
+// `tcheck` each declaration is checked as soon as it is complete and then
+// released, only the symbol table keeps growing. With `input` the whole
+// input is kept there instead, for the passes reporting lines.
+static const ast_node_t* parse_stream(const char* file, typechecker_t* tcheck, source_file_t* input) {
+    source_stream_t stream = open_source_stream(file);
+    stream_parser_t sp = create_stream_parser();
+    sp.keeps_input = input != NULL;
 
-    fseek(stream, 0, SEEK_END);
-    size_t size = ftell(stream);
-    rewind(stream);
+    char* const chunk = malloc(STREAM_CHUNK_SIZE);
+    if(chunk == NULL) {
+        perror(__FILE__);
+        exit(EXIT_FAILURE);
+    }
+
+    const ast_node_t* program = NULL;
+    ast_node_t* last = NULL;
+
+    arena_t* const arena = active_arena();
+    const arena_mark_t mark = arena_mark(arena);
+
+    while(!sp.is_done) {
+        const ast_node_t* decl;
+        while((decl = stream_parser_next(&sp)) != NULL) {
+            if(tcheck != NULL) {
+                typecheck_decl(decl, tcheck);
+                arena_rollback(arena, mark);
+                continue;
+            }
+
+            if(last != NULL) {
+                last->next = decl;
+            } else {
+                program = decl;
+            }
+
+            last = (ast_node_t*)decl;
+        }
+
+        if(sp.is_closed) continue;
+
+        const size_t size = source_stream_read(&stream, chunk, STREAM_CHUNK_SIZE);
+        if(size != 0) {
+            stream_parser_push(&sp, chunk, size);
+        } else {
+            stream_parser_close(&sp);
+        }
+    }
+
+    if(input != NULL) {
+        *input = (source_file_t) {
+            .text = new_string_view(sp.buffer, sp.size),
+            .data = sp.buffer,
+            .capacity = sp.capacity,
+            .is_mapped = false
+        };
+
+        sp.buffer = NULL;
+    }
 
-    char* const buffer = MALLOC(char*, size + 1);
-    fread(buffer, sizeof(char), size, stream);
-    buffer[size] = '\0';
+    free(chunk);
+    destroy_stream_parser(&sp);
+    close_source_stream(&stream);
 
-    fclose(stream);
-    return buffer;
+    return program;
 }
 
+#undef STREAM_CHUNK_SIZE
+
 int main(int argc, char** argv) {
 
-    if(argc < 2) {
-        fprintf(stderr, "%s [file]\n", *argv);
+    bool use_flat_ast = false;
+    bool populate = false;
+    bool use_stream = false;
+    bool check_only = false;
+    bool optimize = false;
+    bool lower = false;
+    bool check_bounds = false;
+    bool plan = false;
+    int jobs = 1;
+    const char* file = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--flat") == 0) {
+            use_flat_ast = true;
+        } else if(strcmp(argv[i], "--populate") == 0) {
+            populate = true;
+        } else if(strcmp(argv[i], "--stream") == 0) {
+            use_stream = true;
+        } else if(strcmp(argv[i], "--check") == 0) {
+            check_only = true;
+        } else if(strcmp(argv[i], "--optimize") == 0) {
+            optimize = true;
+        } else if(strcmp(argv[i], "--lower") == 0) {
+            lower = true;
+        } else if(strcmp(argv[i], "--bounds") == 0) {
+            check_bounds = true;
+        } else if(strcmp(argv[i], "--layout") == 0) {
+            plan = true;
+        } else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else {
+            file = argv[i];
+        }
+    }
+
+    if(file == NULL) {
+        fprintf(stderr, "%s [--flat] [--optimize] [--bounds] [--lower] [--layout] [--populate | --stream | --check] [--jobs N] [file | -]\n", *argv);
         exit(EXIT_FAILURE);
     }
 
-    atexit(free_all);
+    // Before the parser threads of --jobs, which all read the kernels.
+    select_scan_kernels();
 
-    const char* const buffer = read_from_file(argv[1]);
+    arena_t* const arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE);
+    use_arena(arena);
 
-    parser_t p = init_parser(new_string_view_from_cstr(buffer));
-    const ast_node_t* program = parse_program(&p);
+    typechecker_t tcheck = create_typechecker();
+    bool success;
 
-    print_ast(program);
-    puts("\n");
+    // Constant memory: nothing is printed and no AST outlives its declaration.
+    if(check_only) {
+        parse_stream(file, &tcheck, NULL);
+        success = !tcheck.had_error;
 
-    typechecker_t tcheck = create_typechecker();
-    if(typecheck_ast(program, &tcheck)) {
+        if(success) {
+            puts("The type check was successful.");
+        }
+
+        destroy_typechecker(&tcheck);
+        destroy_arena(arena);
+        return 0;
+    }
+
+    source_file_t source = {0};
+    const ast_node_t* program;
+
+    if(use_stream) {
+        program = parse_stream(file, NULL, &source);
+    } else {
+        source = open_source_file(file, populate);
+
+        if(jobs > 1) {
+            program = parse_program_parallel(source.text, jobs);
+        } else {
+            const token_buffer_t tokens = tokenize(source.text);
+
+            parser_t p = init_parser_from_tokens(&tokens);
+            program = parse_program(&p);
+
+            destroy_parser(&p);
+        }
+    }
+
+    optimizer_stats_t stats = {0};
+    lowering_stats_t lowering = {0};
+    bounds_stats_t bounds = {0};
+    bool is_analyzed = false;
+    bool bounds_ok = true;
+    bool is_planned = false;
+    data_layout_t layout = {0};
+
+    // The passes rely on the types, so the program is checked first and the
+    // transformed one is printed.
+    const bool transform = optimize || check_bounds || lower || plan;
+
+    if(transform) {
+        success = typecheck_ast(program, &tcheck);
+    }
+
+    if(transform && success) {
+        if(optimize) {
+            program = optimize_ast(program, &stats);
+        }
+
+        // Before lowering, which merges the subscripts.
+        if(check_bounds) {
+            bounds_ok = analyze_bounds(program, source.text, &bounds);
+            is_analyzed = true;
+        }
+
+        // Out of range accesses stop the passes, not the type check.
+        if(lower && bounds_ok) {
+            program = lower_ast(program, &lowering);
+        }
+
+        if(plan && bounds_ok) {
+            is_planned = plan_layout(program, &layout);
+        }
+    }
+
+    if(use_flat_ast) {
+        const flat_ast_t flat = flatten_ast(program);
+
+        print_flat_ast(&flat);
+        puts("\n");
+
+        if(!transform) {
+            success = typecheck_flat_ast(&flat, &tcheck);
+        }
+    } else {
+        print_ast(program);
+        puts("\n");
+
+        if(!transform) {
+            success = typecheck_ast(program, &tcheck);
+        }
+    }
+
+    if(success) {
         puts("The type check was successful.");
     }
 
+    if(optimize && success) {
+        printf("Optimization removed %zu nodes (%zu folded expressions, %zu dead branches).\n",
+               stats.removed, stats.folded, stats.dead_branches);
+    }
+
+    if(is_analyzed) {
+        const double percent = bounds.accesses != 0 ? 100.0 * bounds.in_range / bounds.accesses : 100.0;
+
+        printf("Bounds analysis proved %zu of %zu accesses in range (%.1f%%), %zu out of range.\n",
+               bounds.in_range, bounds.accesses, percent, bounds.out_of_range);
+    }
+
+    if(lower && success && bounds_ok) {
+        printf("Lowering merged %zu subscripts into %zu element accesses (%zu packed, %zu packed initializers).\n",
+               lowering.subscripts, lowering.accesses, lowering.packed, lowering.packed_initializers);
+    }
+
+    if(is_planned) {
+        print_layout(&layout);
+    }
+
+    destroy_typechecker(&tcheck);
+    close_source_file(&source);
+    destroy_arena(arena);
     return 0;
 }
 
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define EXIT_IF_NULL(ptr)                       \
     if((ptr) == NULL) {                         \
@@ -9,40 +10,145 @@
         exit(EXIT_FAILURE);                     \
     }
 
+#define ALIGN_UP(size) (((size) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
 
-typedef struct _allocated_block {
-    void* ref;
-    struct _allocated_block* next;
-} allocated_block_t;
+// Each thread allocates from its own arena.
+static _Thread_local arena_t* default_arena = NULL;
+static _Thread_local arena_t* current_arena = NULL;
 
-static allocated_block_t* head = NULL;
+static arena_chunk_t* create_chunk(size_t capacity, arena_chunk_t* prev) {
+    arena_chunk_t* const chunk = (arena_chunk_t*)malloc(sizeof(arena_chunk_t) + capacity);
+    EXIT_IF_NULL(chunk);
 
-void* allocate(size_t size) {
-    void* ptr = calloc(1, size);
-    EXIT_IF_NULL(ptr);
+    chunk->prev = prev;
+    chunk->capacity = capacity;
+    chunk->used = 0;
 
-    allocated_block_t* const block = (allocated_block_t*)malloc(sizeof(allocated_block_t));
-    EXIT_IF_NULL(block);
+    return chunk;
+}
 
-    block->ref = ptr;
-    block->next = head;
+arena_t* create_arena(size_t chunk_size) {
+    arena_t* const arena = (arena_t*)malloc(sizeof(arena_t));
+    EXIT_IF_NULL(arena);
 
-    head = block;
+    arena->chunk_size = ALIGN_UP(chunk_size != 0 ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE);
+    arena->current = create_chunk(arena->chunk_size, NULL);
 
-    return ptr;
+    return arena;
 }
 
 #undef EXIT_IF_NULL
 
-void free_all() {
-    allocated_block_t* it = head;
-    allocated_block_t* tmp;
+void* arena_allocate(arena_t* arena, size_t size) {
+    size = ALIGN_UP(size != 0 ? size : 1);
+
+    arena_chunk_t* chunk = arena->current;
+    if(chunk->capacity - chunk->used < size) {
+        // Blocks bigger than a chunk get a chunk of their own.
+        const size_t capacity = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = arena->current = create_chunk(capacity, chunk);
+    }
+
+    void* const ptr = (char*)chunk->data + chunk->used;
+    chunk->used += size;
+
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void arena_reset(arena_t* arena) {
+    arena_chunk_t* it = arena->current;
+
+    while(it->prev != NULL) {
+        arena_chunk_t* const tmp = it;
+        it = it->prev;
+
+        free(tmp);
+    }
+
+    it->used = 0;
+    arena->current = it;
+}
+
+inline arena_mark_t arena_mark(const arena_t* arena) {
+    return (arena_mark_t) {
+        .chunk = arena->current,
+        .used = arena->current->used
+    };
+}
+
+void arena_rollback(arena_t* arena, arena_mark_t mark) {
+    arena_chunk_t* it = arena->current;
+
+    while(it != mark.chunk) {
+        arena_chunk_t* const tmp = it;
+        it = it->prev;
+
+        free(tmp);
+    }
+
+    it->used = mark.used;
+    arena->current = it;
+}
+
+void arena_merge(arena_t* dst, arena_t* src) {
+    arena_chunk_t* oldest = src->current;
+    while(oldest->prev != NULL) {
+        oldest = oldest->prev;
+    }
+
+    // Below the current chunk of `dst`, so that it keeps its free space.
+    oldest->prev = dst->current->prev;
+    dst->current->prev = src->current;
+
+    if(current_arena == src) current_arena = NULL;
+    if(default_arena == src) default_arena = NULL;
+
+    free(src);
+}
+
+void destroy_arena(arena_t* arena) {
+    if(arena == NULL) return;
 
+    arena_chunk_t* it = arena->current;
     while(it != NULL) {
-        tmp = it;
-        it = it->next;
+        arena_chunk_t* const tmp = it;
+        it = it->prev;
 
-        free(tmp->ref);
         free(tmp);
     }
+
+    if(current_arena == arena) current_arena = NULL;
+    if(default_arena == arena) default_arena = NULL;
+
+    free(arena);
+}
+
+#undef ALIGN_UP
+
+arena_t* use_arena(arena_t* arena) {
+    arena_t* const prev = current_arena;
+    current_arena = arena;
+
+    return prev;
+}
+
+arena_t* active_arena() {
+    if(current_arena == NULL) {
+        if(default_arena == NULL) {
+            default_arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE);
+        }
+
+        current_arena = default_arena;
+    }
+
+    return current_arena;
+}
+
+inline void* allocate(size_t size) {
+    return arena_allocate(active_arena(), size);
+}
+
+void free_all() {
+    destroy_arena(default_arena);
 }
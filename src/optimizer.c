@@ -0,0 +1,270 @@
+#include "../include/optimizer.h"
+
+#include <stdint.h>
+
+// =============== Folding ===============
+
+// 2^63, floats whose magnitude reaches it don't fit an int64_t and the
+// expression is left as is.
+#define INTEGER_LIMIT 9223372036854775808.0
+
+// Floats are truncated toward zero, integers and booleans are exact.
+static inline bool literal_to_integer(const literal_expr_t* lit, int64_t* value) {
+    if(!IS_FLOAT_TYPE(lit->type)) {
+        *value = lit->value.integer;
+        return true;
+    }
+
+    if(!(lit->value.real > -INTEGER_LIMIT && lit->value.real < INTEGER_LIMIT)) return false;
+
+    *value = (int64_t)lit->value.real;
+    return true;
+}
+
+#undef INTEGER_LIMIT
+
+// Values of a `float` are rounded once more. The sum, difference, product or
+// quotient of two floats computed on doubles is the exact one rounded, so
+// rounding it to a float gives the same as computing on floats.
+static inline double round_to_type(double value, const type_t* type) {
+    return type->size == sizeof(float) ? (double)(float)value : value;
+}
+
+// Value of the literal converted to the float type `type`.
+static inline double literal_to_real(const literal_expr_t* lit, const type_t* type) {
+    return round_to_type(IS_FLOAT_TYPE(lit->type) ? lit->value.real : (double)lit->value.integer, type);
+}
+
+static inline bool fits_integer_type(int64_t value, const type_t* type) {
+    int64_t low, high;
+    integer_type_range(type, &low, &high);
+
+    return value >= low && value <= high;
+}
+
+static inline const ast_node_t* make_folded(literal_value_t value, const type_t* type) {
+    literal_expr_t* const lit = (literal_expr_t*)make_literal_expr(value, type);
+    lit->base.type = type;
+
+    return (ast_node_t*)lit;
+}
+
+static inline const ast_node_t* make_folded_integer(int64_t value, const type_t* type) {
+    return make_folded(INTEGER_VALUE(value), type);
+}
+
+static inline const ast_node_t* make_folded_real(double value, const type_t* type) {
+    return make_folded(REAL_VALUE(round_to_type(value, type)), type);
+}
+
+#define AS_LITERAL(node) ((const literal_expr_t*)(node))
+
+// Integer operands follow integer semantics: exact results, division
+// truncated toward zero. Overflows of the result type, and divisions by zero,
+// are not folded.
+static const ast_node_t* fold_integer_binary(const binary_expr_t* expr, int64_t a, int64_t b) {
+    int64_t result;
+
+    switch(expr->op.type) {
+        case PLUS:
+            if(__builtin_add_overflow(a, b, &result)) return NULL;
+            break;
+        case MINUS:
+            if(__builtin_sub_overflow(a, b, &result)) return NULL;
+            break;
+        case STAR:
+            if(__builtin_mul_overflow(a, b, &result)) return NULL;
+            break;
+        case SLASH:
+            if(b == 0 || (a == INT64_MIN && b == -1)) return NULL;
+            result = a / b;
+            break;
+        case LESS:
+            return make_folded_integer(a < b, bool_type);
+        case GREATER:
+            return make_folded_integer(a > b, bool_type);
+        case LESS_EQ:
+            return make_folded_integer(a <= b, bool_type);
+        case GREATER_EQ:
+            return make_folded_integer(a >= b, bool_type);
+        default:
+            return NULL;
+    }
+
+    if(!fits_integer_type(result, expr->base.type)) return NULL;
+
+    return make_folded_integer(result, expr->base.type);
+}
+
+// `a` and `b` are already converted to the type the operation is done in.
+static const ast_node_t* fold_float_binary(const binary_expr_t* expr, double a, double b) {
+    switch(expr->op.type) {
+        case PLUS:
+            return make_folded_real(a + b, expr->base.type);
+        case MINUS:
+            return make_folded_real(a - b, expr->base.type);
+        case STAR:
+            return make_folded_real(a * b, expr->base.type);
+        case SLASH:
+            return make_folded_real(a / b, expr->base.type);
+        case LESS:
+            return make_folded_integer(a < b, bool_type);
+        case GREATER:
+            return make_folded_integer(a > b, bool_type);
+        case LESS_EQ:
+            return make_folded_integer(a <= b, bool_type);
+        case GREATER_EQ:
+            return make_folded_integer(a >= b, bool_type);
+        default:
+            return NULL;
+    }
+}
+
+// Returns NULL when the expression can't be folded.
+static const ast_node_t* fold_expr(const ast_node_t* node) {
+    switch(node->kind) {
+        case BINARY_EXPR_NODE: {
+            const binary_expr_t* const expr = (binary_expr_t*)node;
+            if(expr->left->kind != LITERAL_NODE || expr->right->kind != LITERAL_NODE) return NULL;
+
+            const literal_expr_t* const left = AS_LITERAL(expr->left);
+            const literal_expr_t* const right = AS_LITERAL(expr->right);
+
+            if(IS_INTEGER_TYPE(left->type) && IS_INTEGER_TYPE(right->type)) {
+                int64_t a, b;
+                if(!literal_to_integer(left, &a) || !literal_to_integer(right, &b)) return NULL;
+
+                return fold_integer_binary(expr, a, b);
+            }
+
+            const type_t* const type = cast_to_bigger(left->type, right->type);
+
+            return fold_float_binary(expr, literal_to_real(left, type), literal_to_real(right, type));
+        }
+        case UNARY_EXPR_NODE: {
+            const unary_expr_t* const expr = (unary_expr_t*)node;
+            if(expr->right->kind != LITERAL_NODE) return NULL;
+
+            const literal_expr_t* const operand = AS_LITERAL(expr->right);
+
+            if(expr->op.type == PLUS) {
+                return make_folded(operand->value, operand->type);
+            }
+
+            if(IS_INTEGER_TYPE(operand->type)) {
+                int64_t value;
+                if(!literal_to_integer(operand, &value) || value == INT64_MIN) return NULL;
+                if(!fits_integer_type(-value, operand->type)) return NULL;
+
+                return make_folded_integer(-value, operand->type);
+            }
+
+            return make_folded_real(-operand->value.real, operand->type);
+        }
+        case CASTING_EXPR_NODE: {
+            const casting_expr_t* const expr = (casting_expr_t*)node;
+            if(expr->expr->kind != LITERAL_NODE) return NULL;
+
+            const literal_expr_t* const operand = AS_LITERAL(expr->expr);
+
+            // Floats are truncated toward zero, booleans are already 0 or 1.
+            // A value that a narrower integer can't hold isn't folded.
+            if(IS_INTEGER_TYPE(expr->target_type)) {
+                int64_t value;
+                if(!literal_to_integer(operand, &value)) return NULL;
+                if(!fits_integer_type(value, expr->target_type)) return NULL;
+
+                return make_folded_integer(value, expr->target_type);
+            }
+
+            return make_folded_real(literal_to_real(operand, expr->target_type), expr->target_type);
+        }
+        default:
+            return NULL;
+    }
+}
+
+#undef AS_LITERAL
+
+// A constant condition leaves a literal expression statement, which does nothing.
+static inline bool is_noop(const ast_node_t* node) {
+    return node != NULL
+        && node->kind == EXPR_STATEMENT_NODE
+        && ((expr_statement_t*)node)->expr->kind == LITERAL_NODE;
+}
+
+// Returns the node that replaces `node` once its children are rewritten.
+static const ast_node_t* fold_node(const ast_node_t* node, void* context) {
+    optimizer_stats_t* const stats = context;
+
+    switch(node->kind) {
+        case BINARY_EXPR_NODE:
+        case UNARY_EXPR_NODE:
+        case CASTING_EXPR_NODE: {
+            // Only expressions that typechecked are touched.
+            if(node->type == NULL) return node;
+
+            const ast_node_t* const folded = fold_expr(node);
+            if(folded == NULL) return node;
+
+            stats->folded++;
+            stats->removed += (node->kind == BINARY_EXPR_NODE) ? 2 : 1;
+
+            return folded;
+        }
+        case IF_STATEMENT_NODE: {
+            if_statement_t* const stmt = (if_statement_t*)node;
+
+            if(is_noop(stmt->otherwise)) {
+                stmt->otherwise = NULL;
+                stats->removed += 2;
+            }
+
+            if(stmt->condition->kind != LITERAL_NODE) return node;
+
+            const ast_node_t* const taken = ((literal_expr_t*)stmt->condition)->value.integer != 0
+                ? stmt->then
+                : stmt->otherwise;
+
+            const ast_node_t* const replacement = taken != NULL
+                ? taken
+                : make_expr_stmt(stmt->condition);
+
+            stats->dead_branches++;
+            stats->removed += count_ast_nodes(node) - count_ast_nodes(replacement);
+
+            return replacement;
+        }
+        default:
+            return node;
+    }
+}
+
+const ast_node_t* optimize_ast(const ast_node_t* program, optimizer_stats_t* stats) {
+    program = rewrite_ast(program, fold_node, stats);
+
+    const ast_node_t* head = NULL;
+    ast_node_t* last = NULL;
+
+    // Statements left without effect are dropped from the program.
+    for(const ast_node_t* it = program; it != NULL; it = it->next) {
+        if(is_noop(it)) {
+            stats->removed += 2;
+            continue;
+        }
+
+        if(last != NULL) {
+            last->next = it;
+        } else {
+            head = it;
+        }
+
+        last = (ast_node_t*)it;
+    }
+
+    if(last != NULL) {
+        last->next = NULL;
+    }
+
+    return head;
+}
@@ -1,28 +1,68 @@
 #include "../include/parser.h"
+#include "../include/source.h"
+#include "../include/memory.h"
+#include "../include/scan.h"
+#include "../include/literal.h"
 
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <threads.h>
 
 #define PARSER_CURR(p) (p->curr)
 #define PARSER_PREV(p) (p->prev)
+#define TOKEN_LEXEME(p, token) \
+    (new_string_view(TOKEN_TEXT((p)->lexer.source, token), (token).length))
+#define PARSER_LINE(p, token) \
+    (source_location((p)->lexer.source, (token).start).line + (p)->first_line - 1)
+
+#define PARSER_ERROR(p, token, message)                                     \
+    do {                                                                    \
+        if((p)->on_error != NULL) longjmp(*(p)->on_error, 1);               \
+        fprintf(stderr, "[Ln: %d] " message "\n", PARSER_LINE(p, token));   \
+        exit(EXIT_FAILURE);                                                 \
+    } while(0)
 
 inline parser_t init_parser(string_view_t source) {
 
-    lexer_t lex = INIT_LEXER(source);
-    
+    parser_t p = {
+        .lexer = INIT_LEXER(source),
+        .tokens = NULL,
+        .first_line = 1,
+        .on_error = NULL
+    };
+
+    p.curr = next_token(&p.lexer);
+    return p;
+}
+
+inline parser_t init_parser_from_tokens(const token_buffer_t* tokens) {
     return (parser_t) {
-        .lexer = lex,
-        .curr = next_token(&lex)
+        .lexer = INIT_LEXER(tokens->source),
+        .tokens = tokens,
+        .position = 0,
+        .curr = token_buffer_get(tokens, 0),
+        .first_line = 1,
+        .on_error = NULL
     };
 }
 
 static inline void parser_advance(parser_t* restrict p) {
     p->prev = p->curr;
 
-    if(p->curr.type != TOK_EOF && p->curr.type != TOK_ERR) {
-        p->curr = next_token(&p->lexer);
+    if(p->curr.type == TOK_EOF || p->curr.type == TOK_ERR) {
+        return;
     }
+
+    if(p->tokens != NULL) {
+        p->curr = token_buffer_get(p->tokens, ++p->position);
+        return;
+    }
+
+    p->curr = next_token(&p->lexer);
 }
 
 static inline bool parser_match(parser_t* restrict p, token_type_t type) {
@@ -36,259 +76,862 @@ static inline token_t parser_consume(parser_t* restrict p, int kind) {
        return PARSER_PREV(p);
     }
 
-    fprintf(stderr, "[Ln: %d] Parser error unexpected token.\n", PARSER_CURR(p).line);
-    exit(EXIT_FAILURE);
+    PARSER_ERROR(p, PARSER_CURR(p), "Parser error unexpected token.");
 }
 
-static const ast_node_t* parse_expression(parser_t* p);
-static const ast_node_t* parse_statement(parser_t* p);
+// Binding powers of the infix and postfix operators, tokens which can't
+// continue an expression have none. Each level binds tighter than the ones
+// before it, the prefix operators sit between casting and subscripts.
+enum {
+    BP_NONE = 0,
+    BP_ASSIGNMENT,
+    BP_COMPARISON,
+    BP_TERM,
+    BP_FACTOR,
+    BP_CASTING,
+    BP_UNARY,
+    BP_SUBSCRIPT
+};
+
+static const uint8_t binding_powers[TOK_SUSPEND + 1] = {
+    [ASSIGN] = BP_ASSIGNMENT,
+
+    [GREATER] = BP_COMPARISON,
+    [GREATER_EQ] = BP_COMPARISON,
+    [LESS] = BP_COMPARISON,
+    [LESS_EQ] = BP_COMPARISON,
+
+    [PLUS] = BP_TERM,
+    [MINUS] = BP_TERM,
+
+    [STAR] = BP_FACTOR,
+    [SLASH] = BP_FACTOR,
+
+    [AS_KEYWORD] = BP_CASTING,
+    [LEFT_BRACKET] = BP_SUBSCRIPT
+};
+
+// The parser doesn't recurse: every construct waiting for a nested
+// expression, statement, initializer or array dimension is a frame on
+// `p->frames`, so nesting is only bounded by memory.
+typedef enum {
+    // Expressions waiting for their operand.
+    FRAME_UNARY,
+    FRAME_BINARY,
+    FRAME_ASSIGN,
+    FRAME_PAREN,
+    FRAME_SUBSCRIPT,
+
+    // Waiting for a complete expression, statement or initializer.
+    FRAME_EXPR_STATEMENT,
+    FRAME_IF_CONDITION,
+    FRAME_IF_THEN,
+    FRAME_IF_ELSE,
+    FRAME_VARIABLE_DECL,
+    FRAME_INITIALIZER,
+
+    FRAME_ARRAY_LENGTH
+} parse_frame_kind_t;
+
+typedef struct _parse_frame {
+    uint8_t kind;
+
+    // Operators binding less than this end the operand.
+    uint8_t min_bp;
+
+    // Operator, opening bracket, name of the variable, or length of the array.
+    token_t token;
+
+    // Left operand, condition, or first element.
+    const ast_node_t* left;
+    // Then branch, or last element.
+    const ast_node_t* right;
+
+    const type_t* type;
+} parse_frame_t;
+
+#define INITIAL_FRAMES 32
+
+static inline parse_frame_t* push_frame(parser_t* p, parse_frame_kind_t kind, int min_bp) {
+    if(p->frames_count == p->frames_capacity) {
+        p->frames_capacity = p->frames_capacity != 0 ? p->frames_capacity * 2 : INITIAL_FRAMES;
+        p->frames = realloc(p->frames, sizeof(parse_frame_t) * p->frames_capacity);
+
+        if(p->frames == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+    }
 
-static const ast_node_t* parse_primary(parser_t* p) {
+    parse_frame_t* const frame = &p->frames[p->frames_count++];
+    frame->kind = kind;
+    frame->min_bp = min_bp;
 
-    if(parser_match(p, INTEGER_LITERAL) || parser_match(p, FLOATING_LITERAL)) {
+    return frame;
+}
 
-        const float value = strtof(string_view_data(PARSER_PREV(p).lexeme), NULL);
-        const type_t* type = PARSER_PREV(p).type == FLOATING_LITERAL
-            ? float_type
-            : int_type;
+#undef INITIAL_FRAMES
 
-        return make_literal_expr(value, type);
-    }
+#define TOP_FRAME(p) (&(p)->frames[(p)->frames_count - 1])
+#define POP_FRAME(p) ((p)->frames_count--)
 
+void destroy_parser(parser_t* p) {
+    free(p->frames);
 
-    if(parser_match(p, TRUE_KEYWORD) || parser_match(p, FALSE_KEYWORD)) {
-        const float value = PARSER_PREV(p).type == TRUE_KEYWORD;
-        return make_literal_expr(value, bool_type);
-    }
+    p->frames = NULL;
+    p->frames_count = 0;
+    p->frames_capacity = 0;
+}
 
-    if(parser_match(p, LEFT_PAREN)) {
-        const ast_node_t* const expr = parse_expression(p);
-        parser_consume(p, RIGHT_PAREN);
+static const type_t* parse_type(parser_t* p) {
 
-        return expr;
-    }
+    const type_t* type = NULL;
 
-    if(parser_match(p, IDENTIFIER)) {
-        return make_variable_expr(PARSER_PREV(p));
+    switch(PARSER_CURR(p).type) {
+        case FLOAT_KEYWORD:
+        case F32_KEYWORD:
+            type = float_type;
+            break;
+        case INTEGER_KEYWORD:
+        case I64_KEYWORD:
+            type = int_type;
+            break;
+        case BOOL_KEYWORD:
+            type = bool_type;
+            break;
+        case I8_KEYWORD:
+            type = i8_type;
+            break;
+        case I16_KEYWORD:
+            type = i16_type;
+            break;
+        case I32_KEYWORD:
+            type = i32_type;
+            break;
+        case F64_KEYWORD:
+            type = f64_type;
+            break;
+        default:
+            PARSER_ERROR(p, PARSER_CURR(p), "Unknown data type.");
     }
 
-    fprintf(stderr, "[Ln: %d] Unknown expression.\n", PARSER_CURR(p).line);
-    exit(EXIT_FAILURE);
-}
+    parser_advance(p);
 
-static const ast_node_t* parse_subscript(parser_t* p) {
-    const ast_node_t* expr = parse_primary(p);
+    // The last dimension is the innermost one.
+    const uint32_t base = p->frames_count;
 
     while(parser_match(p, LEFT_BRACKET)) {
-        expr = make_subscript_expr(expr, parse_expression(p));
+        const token_t literal = parser_consume(p, INTEGER_LITERAL);
         parser_consume(p, RIGHT_BRACKET);
+
+        push_frame(p, FRAME_ARRAY_LENGTH, BP_NONE)->token = literal;
     }
 
-    return expr;
-}
+    while(p->frames_count > base) {
+        const token_t literal = TOP_FRAME(p)->token;
+        POP_FRAME(p);
 
-static const ast_node_t* parse_unary(parser_t* p) {
+        int64_t length;
+        if(!parse_integer_literal(TOKEN_LEXEME(p, literal), &length) || length > INT_MAX) {
+            PARSER_ERROR(p, literal, "Array length is too large.");
+        }
 
-    if(parser_match(p, MINUS) || parser_match(p, PLUS)) {
-        token_t op = PARSER_PREV(p);
-        return make_unary_expr(op, parse_unary(p));
+        type = create_array_type(type, (int)length);
     }
-    
-    return parse_subscript(p);
-}
 
-static const type_t* parse_type_suffix(parser_t* p, const type_t* type) {
+    return type;
+}
 
-    if(!parser_match(p, LEFT_BRACKET))  {
-        return type;
+typedef enum {
+    PARSE_DECL,
+    PARSE_STATEMENT,
+    PARSE_INITIALIZER,
+
+    // Expecting the start of an operand.
+    PARSE_PREFIX,
+    // After an operand, which operators may extend.
+    PARSE_INFIX,
+    // `value` is complete, hand it to the frame on top.
+    PARSE_REDUCE
+} parse_state_t;
+
+static const ast_node_t* parse_decl(parser_t* p) {
+
+    parse_state_t state = PARSE_DECL;
+    const ast_node_t* value = NULL;
+
+    p->frames_count = 0;
+
+    for(;;) {
+        switch(state) {
+            case PARSE_DECL: {
+                if(!parser_match(p, VAR_KEYWORD) && !parser_match(p, LET_KEYWORD)) {
+                    state = PARSE_STATEMENT;
+                    break;
+                }
+
+                const bool is_type_inferred = PARSER_PREV(p).type == LET_KEYWORD;
+
+                const token_t name = parser_consume(p, IDENTIFIER);
+                const type_t* const type = !is_type_inferred
+                    ? parse_type(p)
+                    : NULL;
+
+                if(parser_match(p, ASSIGN)) {
+                    parse_frame_t* const frame = push_frame(p, FRAME_VARIABLE_DECL, BP_ASSIGNMENT);
+                    frame->token = name;
+                    frame->type = type;
+
+                    state = PARSE_INITIALIZER;
+                    break;
+                }
+
+                if(is_type_inferred) {
+                    PARSER_ERROR(p, name, "Variables declared with 'let' must be initialized.");
+                }
+
+                parser_consume(p, SEMICOLON);
+
+                value = make_var_decl(name, type, NULL);
+                state = PARSE_REDUCE;
+                break;
+            }
+            case PARSE_STATEMENT:
+                push_frame(p, parser_match(p, IF_KEYWORD) ? FRAME_IF_CONDITION : FRAME_EXPR_STATEMENT,
+                           BP_ASSIGNMENT);
+
+                state = PARSE_PREFIX;
+                break;
+            case PARSE_INITIALIZER:
+                if(parser_match(p, LEFT_BRACE)) {
+                    push_frame(p, FRAME_INITIALIZER, BP_ASSIGNMENT)->left = NULL;
+                } else {
+                    state = PARSE_PREFIX;
+                }
+
+                break;
+            case PARSE_PREFIX: {
+                const token_t token = PARSER_CURR(p);
+
+                switch(token.type) {
+                    case INTEGER_LITERAL:
+                    case FLOATING_LITERAL: {
+                        parser_advance(p);
+
+                        if(token.type == FLOATING_LITERAL) {
+                            float number;
+                            if(!parse_float_literal(TOKEN_LEXEME(p, token), &number)) {
+                                PARSER_ERROR(p, token, "Floating literal is too large.");
+                            }
+
+                            value = make_literal_expr(REAL_VALUE(number), float_type);
+                        } else {
+                            int64_t number;
+                            if(!parse_integer_literal(TOKEN_LEXEME(p, token), &number)) {
+                                PARSER_ERROR(p, token, "Integer literal is too large.");
+                            }
+
+                            value = make_literal_expr(INTEGER_VALUE(number), int_type);
+                        }
+
+                        state = PARSE_INFIX;
+                        break;
+                    }
+                    case TRUE_KEYWORD:
+                    case FALSE_KEYWORD:
+                        parser_advance(p);
+
+                        value = make_literal_expr(INTEGER_VALUE(token.type == TRUE_KEYWORD), bool_type);
+                        state = PARSE_INFIX;
+                        break;
+                    case IDENTIFIER:
+                        parser_advance(p);
+
+                        value = make_variable_expr(token);
+                        state = PARSE_INFIX;
+                        break;
+                    case LEFT_PAREN:
+                        parser_advance(p);
+                        push_frame(p, FRAME_PAREN, BP_ASSIGNMENT);
+                        break;
+                    case MINUS:
+                    case PLUS:
+                        parser_advance(p);
+                        push_frame(p, FRAME_UNARY, BP_UNARY)->token = token;
+                        break;
+                    default:
+                        PARSER_ERROR(p, token, "Unknown expression.");
+                }
+
+                break;
+            }
+            case PARSE_INFIX: {
+                const token_t op = PARSER_CURR(p);
+                const int bp = binding_powers[op.type];
+
+                if(bp == BP_NONE || bp < TOP_FRAME(p)->min_bp) {
+                    state = PARSE_REDUCE;
+                    break;
+                }
+
+                parser_advance(p);
+
+                switch(op.type) {
+                    case ASSIGN:
+                        if(value->kind != VARIABLE_EXPR_NODE &&
+                           value->kind != SUBSCRIPT_EXPR_NODE) {
+                            PARSER_ERROR(p, PARSER_CURR(p), "Can't assign to an rvalue.");
+                        }
+
+                        // Right associative.
+                        push_frame(p, FRAME_ASSIGN, BP_ASSIGNMENT)->left = value;
+                        state = PARSE_PREFIX;
+                        break;
+                    case AS_KEYWORD:
+                        value = make_casting_expr(value, parse_type(p));
+                        break;
+                    case LEFT_BRACKET: {
+                        parse_frame_t* const frame = push_frame(p, FRAME_SUBSCRIPT, BP_ASSIGNMENT);
+                        frame->token = op;
+                        frame->left = value;
+
+                        state = PARSE_PREFIX;
+                        break;
+                    }
+                    default: {
+                        parse_frame_t* const frame = push_frame(p, FRAME_BINARY, bp + 1);
+                        frame->token = op;
+                        frame->left = value;
+
+                        state = PARSE_PREFIX;
+                        break;
+                    }
+                }
+
+                break;
+            }
+            case PARSE_REDUCE: {
+                if(p->frames_count == 0) {
+                    return value;
+                }
+
+                parse_frame_t* const frame = TOP_FRAME(p);
+
+                switch(frame->kind) {
+                    case FRAME_UNARY:
+                        value = make_unary_expr(frame->token, value);
+                        POP_FRAME(p);
+
+                        state = PARSE_INFIX;
+                        break;
+                    case FRAME_BINARY:
+                        value = make_binary_expr(frame->token, frame->left, value);
+                        POP_FRAME(p);
+
+                        state = PARSE_INFIX;
+                        break;
+                    case FRAME_ASSIGN:
+                        value = make_assign_expr(frame->left, value);
+                        POP_FRAME(p);
+
+                        state = PARSE_INFIX;
+                        break;
+                    case FRAME_PAREN:
+                        parser_consume(p, RIGHT_PAREN);
+                        POP_FRAME(p);
+
+                        state = PARSE_INFIX;
+                        break;
+                    case FRAME_SUBSCRIPT:
+                        value = make_subscript_expr(frame->left, value, frame->token.start);
+                        parser_consume(p, RIGHT_BRACKET);
+                        POP_FRAME(p);
+
+                        state = PARSE_INFIX;
+                        break;
+                    case FRAME_EXPR_STATEMENT:
+                        parser_consume(p, SEMICOLON);
+                        POP_FRAME(p);
+
+                        value = make_expr_stmt(value);
+                        break;
+                    case FRAME_IF_CONDITION:
+                        parser_consume(p, THEN_KEYWORD);
+
+                        frame->kind = FRAME_IF_THEN;
+                        frame->left = value;
+
+                        state = PARSE_STATEMENT;
+                        break;
+                    case FRAME_IF_THEN:
+                        if(parser_match(p, ELSE_KEYWORD)) {
+                            frame->kind = FRAME_IF_ELSE;
+                            frame->right = value;
+
+                            state = PARSE_STATEMENT;
+                            break;
+                        }
+
+                        value = make_if_stmt(frame->left, value, NULL);
+                        POP_FRAME(p);
+                        break;
+                    case FRAME_IF_ELSE:
+                        value = make_if_stmt(frame->left, frame->right, value);
+                        POP_FRAME(p);
+                        break;
+                    case FRAME_VARIABLE_DECL:
+                        parser_consume(p, SEMICOLON);
+
+                        value = make_var_decl(frame->token, frame->type, value);
+                        POP_FRAME(p);
+                        break;
+                    case FRAME_INITIALIZER:
+                        if(frame->left != NULL) {
+                            ((ast_node_t*)frame->right)->next = value;
+                        } else {
+                            frame->left = value;
+                        }
+
+                        frame->right = value;
+
+                        if(parser_match(p, COMMA)) {
+                            state = PARSE_INITIALIZER;
+                            break;
+                        }
+
+                        parser_consume(p, RIGHT_BRACE);
+
+                        value = make_initializer(frame->left);
+                        POP_FRAME(p);
+                        break;
+                }
+
+                break;
+            }
+        }
     }
+}
+
+#undef TOP_FRAME
+#undef POP_FRAME
+
+const ast_node_t* parse_program(parser_t* p) {
+
+    ast_node_t* program = (ast_node_t*) parse_decl(p);
+    ast_node_t* curr = program;
 
-    token_t literal = parser_consume(p, INTEGER_LITERAL);
-    unsigned int length = strtol(string_view_data(literal.lexeme), NULL, 10);
-    parser_consume(p, RIGHT_BRACKET);
+    while(PARSER_CURR(p).type != TOK_EOF) {
+        ast_node_t* node = (ast_node_t*)parse_decl(p);
+        curr->next = node;
+        curr = node;
+    }
 
-    return create_array_type(parse_type_suffix(p, type), length);
+    return program;
 }
 
-static const type_t* parse_type(parser_t* p) {
+// =============== Stream parser ===============
 
-    const type_t* type = NULL;
+#define STREAM_INITIAL_CAPACITY (64 * 1024)
 
-    if(parser_match(p, FLOAT_KEYWORD)) {
-        type = float_type;
-    } else if(parser_match(p, INTEGER_KEYWORD)) {
-        type = int_type;
-    } else if(parser_match(p, BOOL_KEYWORD)) {
-        type = bool_type;
-    } else {
-        fprintf(stderr, "[Ln: %d] Unknown data type.\n", PARSER_CURR(p).line);
+stream_parser_t create_stream_parser() {
+    char* const buffer = malloc(STREAM_INITIAL_CAPACITY);
+    if(buffer == NULL) {
+        perror(__FILE__);
         exit(EXIT_FAILURE);
     }
 
-    return parse_type_suffix(p, type);
+    memset(buffer, 0, 1 + LEXER_PADDING);
+
+    return (stream_parser_t) {
+        .parser = {
+            .tokens = NULL,
+            .first_line = 1,
+            .on_error = NULL
+        },
+        .buffer = buffer,
+        .size = 0,
+        .capacity = STREAM_INITIAL_CAPACITY,
+        .consumed = 0,
+        .tokens = { .count = 0, .capacity = 0 },
+        .lexed = 0,
+        .checked = 0,
+        .depth = 0,
+        .after_semicolon = false,
+        .count = 0,
+        .keeps_input = false,
+        .is_closed = false,
+        .is_done = false
+    };
 }
 
-static const ast_node_t* parse_casting(parser_t* p) {
+void destroy_stream_parser(stream_parser_t* sp) {
+    destroy_parser(&sp->parser);
 
-    const ast_node_t* left = parse_unary(p);
-
-    while(parser_match(p, AS_KEYWORD)) {
-        const type_t* const type = parse_type(p);
-        left = make_casting_expr(left, type);
-    }
+    free(sp->buffer);
+    sp->buffer = NULL;
 
-    return left;
+    free(sp->tokens.types);
+    free(sp->tokens.starts);
+    free(sp->tokens.lengths);
+    free(sp->tokens.ids);
+    sp->tokens = (token_buffer_t) { .count = 0, .capacity = 0 };
 }
 
-static const ast_node_t* parse_factor(parser_t* p) {
-    const ast_node_t* left = parse_casting(p);
+// Drops the declarations already returned.
+static void compact_stream_buffer(stream_parser_t* sp) {
+    if(sp->consumed == 0 || sp->keeps_input) return;
 
-    while(parser_match(p, STAR) || parser_match(p, SLASH)) {
-        token_t op = PARSER_PREV(p);
-        left = make_binary_expr(op, left, parse_casting(p));
+    for(size_t i = 0; i < sp->consumed; i++) {
+        sp->parser.first_line += (sp->buffer[i] == '\n');
     }
 
-    return left;
+    for(size_t i = 0; i < sp->tokens.count; i++) {
+        sp->tokens.starts[i] -= (uint32_t)sp->consumed;
+    }
+
+    sp->lexed -= sp->consumed;
+    sp->size -= sp->consumed;
+    memmove(sp->buffer, sp->buffer + sp->consumed, sp->size);
+    sp->consumed = 0;
 }
 
-static const ast_node_t* parse_term(parser_t* p) {
-    const ast_node_t* left = parse_factor(p);
+void stream_parser_push(stream_parser_t* sp, const char* data, size_t size) {
+    compact_stream_buffer(sp);
+
+    const size_t required = sp->size + size + 1 + LEXER_PADDING;
+    if(required > sp->capacity) {
+        size_t capacity = sp->capacity;
+        while(capacity < required) {
+            capacity *= 2;
+        }
+
+        sp->buffer = realloc(sp->buffer, capacity);
+        if(sp->buffer == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
 
-    while(parser_match(p, PLUS) || parser_match(p, MINUS)) {
-        token_t op = PARSER_PREV(p);
-        left = make_binary_expr(op, left, parse_factor(p));
+        sp->capacity = capacity;
+    }
+
+    memcpy(sp->buffer + sp->size, data, size);
+    sp->size += size;
+
+    // Tokens address the buffer with 32-bit offsets.
+    if(sp->size >= UINT32_MAX) {
+        fprintf(stderr, "[Ln: %d] Declaration too large.\n", sp->parser.first_line);
+        exit(EXIT_FAILURE);
     }
 
-    return left;
+    memset(sp->buffer + sp->size, 0, 1 + LEXER_PADDING);
 }
 
-static const ast_node_t* parse_comparison(parser_t* p) {
-    const ast_node_t* left = parse_term(p);
+inline void stream_parser_close(stream_parser_t* sp) {
+    sp->is_closed = true;
+}
+
+// Appends `token`, keeping room for the sentinel after it.
+static void push_stream_token(token_buffer_t* tokens, token_t token) {
+    if(tokens->count + 1 >= tokens->capacity) {
+        const size_t capacity = tokens->capacity != 0 ? tokens->capacity * 2 : 256;
 
-    while(parser_match(p, GREATER) || 
-          parser_match(p, GREATER_EQ) || 
-          parser_match(p, LESS) || 
-          parser_match(p, LESS_EQ)) {
-        token_t op = PARSER_PREV(p);
-        left = make_binary_expr(op, left,parse_term(p));
+        tokens->types = realloc(tokens->types, sizeof(uint8_t) * capacity);
+        tokens->starts = realloc(tokens->starts, sizeof(uint32_t) * capacity);
+        tokens->lengths = realloc(tokens->lengths, sizeof(uint32_t) * capacity);
+        tokens->ids = realloc(tokens->ids, sizeof(intern_id_t) * capacity);
+
+        if(tokens->types == NULL || tokens->starts == NULL ||
+           tokens->lengths == NULL || tokens->ids == NULL) {
+            perror(__FILE__);
+            exit(EXIT_FAILURE);
+        }
+
+        tokens->capacity = capacity;
     }
 
-    return left;
+    const size_t i = tokens->count++;
+    tokens->types[i] = token.type;
+    tokens->starts[i] = token.start;
+    tokens->lengths[i] = token.length;
+    tokens->ids[i] = token.id;
 }
 
-static const ast_node_t* parse_assignment(parser_t* p) {
+// Lexes the pushed input until the tokens hold a whole declaration and the
+// token after it: a top-level `;` not followed by `else`, like the parallel
+// parser splits the source, or the end of the input. Returns the number of
+// tokens up to that one, or 0 when more input is needed.
+static size_t lex_stream_declaration(stream_parser_t* sp) {
+    token_buffer_t* const tokens = &sp->tokens;
 
-    const ast_node_t* lvalue = parse_comparison(p);
+    lexer_t lex = INIT_LEXER(new_string_view(sp->buffer, sp->size));
+    lex.current = (uint32_t)sp->lexed;
+    lex.is_final = sp->is_closed;
 
-    if(parser_match(p, ASSIGN)) {
+    for(;; sp->checked++) {
+        if(sp->checked == tokens->count) {
+            const token_t token = next_token(&lex);
+            if(token.type == TOK_SUSPEND) return 0;
 
-        if(lvalue->kind != VARIABLE_EXPR_NODE &&
-           lvalue->kind != SUBSCRIPT_EXPR_NODE) {
-            fprintf(stderr, "[Ln: %d] Can't assign to an rvalue.\n",
-                    PARSER_CURR(p).line);
-            exit(EXIT_FAILURE);
+            push_stream_token(tokens, token);
+            sp->lexed = lex.current;
         }
-    
-        return make_assign_expr(lvalue, parse_assignment(p));
+
+        const uint8_t type = tokens->types[sp->checked];
+
+        if(type == TOK_EOF || type == TOK_ERR || (sp->after_semicolon && type != ELSE_KEYWORD)) {
+            return sp->checked + 1;
+        }
+
+        sp->after_semicolon = type == SEMICOLON && sp->depth == 0;
+        sp->depth += (type == LEFT_BRACE) - (type == RIGHT_BRACE);
     }
-    
-    return lvalue;
 }
 
-static inline const ast_node_t* parse_expression(parser_t* p){
-    return parse_assignment(p);
+// Drops the first `count` tokens, the others are checked again.
+static void drop_stream_tokens(stream_parser_t* sp, size_t count) {
+    token_buffer_t* const tokens = &sp->tokens;
+    const size_t kept = tokens->count - count;
+
+    memmove(tokens->types, tokens->types + count, sizeof(uint8_t) * kept);
+    memmove(tokens->starts, tokens->starts + count, sizeof(uint32_t) * kept);
+    memmove(tokens->lengths, tokens->lengths + count, sizeof(uint32_t) * kept);
+    memmove(tokens->ids, tokens->ids + count, sizeof(intern_id_t) * kept);
+
+    tokens->count = kept;
+    sp->checked = 0;
+    sp->depth = 0;
+    sp->after_semicolon = false;
 }
 
-static const ast_node_t* parse_initializer(parser_t* p) {
+const ast_node_t* stream_parser_next(stream_parser_t* sp) {
+    if(sp->is_done) return NULL;
 
-    if(!parser_match(p, LEFT_BRACE)) {
-        return parse_expression(p);
-    }
+    const size_t count = lex_stream_declaration(sp);
+    if(count == 0) return NULL;
+
+    token_buffer_t* const tokens = &sp->tokens;
 
-    ast_node_t* const initializer = (ast_node_t*) parse_initializer(p);
-    for(ast_node_t* curr = initializer; parser_match(p, COMMA); curr = (ast_node_t*) curr->next) {
-        curr->next = parse_initializer(p);
+    // Like `parse_program`, an empty program is reported by `parse_decl`.
+    if(tokens->types[0] == TOK_EOF && sp->count > 0) {
+        sp->is_done = true;
+        return NULL;
     }
-    
-    parser_consume(p, RIGHT_BRACE);
 
-    return make_initializer(initializer);
+    // Past the last token the parser only sees the end of the input. It
+    // stops before it, unless the declaration has a syntax error.
+    tokens->types[tokens->count] = TOK_EOF;
+    tokens->starts[tokens->count] = tokens->starts[count - 1];
+    tokens->lengths[tokens->count] = 0;
+
+    parser_t* const p = &sp->parser;
+    p->lexer = INIT_LEXER(new_string_view(sp->buffer, sp->size));
+    p->tokens = tokens;
+    p->position = 0;
+    p->curr = token_buffer_get(tokens, 0);
+
+    const ast_node_t* const decl = parse_decl(p);
+
+    sp->consumed = p->curr.start;
+    sp->count++;
+
+    drop_stream_tokens(sp, p->position);
+    p->tokens = NULL;
+
+    return decl;
 }
 
-static const ast_node_t* parse_var_declaration(parser_t* p) {
+#undef STREAM_INITIAL_CAPACITY
 
-    const bool is_type_inferred = PARSER_PREV(p).type == LET_KEYWORD;
+// =============== Parallel parser ===============
 
-    token_t name = parser_consume(p, IDENTIFIER);
+typedef struct {
+    string_view_t source;
 
-    const type_t* type = !is_type_inferred 
-        ? parse_type(p)
-        : NULL;
+    // Bytes of the source covered by this job.
+    uint32_t begin;
+    uint32_t end;
 
-    const ast_node_t* initializer = NULL;
-    if(parser_match(p, ASSIGN)) {
-        initializer = parse_initializer(p);
-    }
+    arena_t* arena;
+    parser_t parser;
 
-    if(initializer == NULL && is_type_inferred) {
-        fprintf(stderr, "[Ln: %d] Variables declared with 'let' must be initialized.\n", name.line);
-        exit(EXIT_FAILURE);
-    }
+    const ast_node_t* first;
+    ast_node_t* last;
+
+    // Start of the first token, and of the token after the last declaration.
+    uint32_t first_token;
+    uint32_t stop;
 
-    parser_consume(p, SEMICOLON);
+    bool failed;
+} parse_job_t;
 
-    return make_var_decl(name, type, initializer);
+static inline const char* skip_blanks_and_comments(const char* it) {
+    for(;;) {
+        it = scan.skip_blanks(it);
+        if(*it != '#') return it;
+
+        it = scan.find_line_end(it);
+    }
 }
 
+// A top-level `;` ends a declaration, unless an `else` follows it.
+static inline bool ends_declaration(const char* it) {
+    it = skip_blanks_and_comments(it);
+    return !(strncmp(it, "else", 4) == 0 && !isalnum((unsigned char)it[4]));
+}
 
-static inline const ast_node_t* parse_expr_statement(parser_t* p) {
-    const ast_node_t* expr = parse_expression(p);
-    parser_consume(p, SEMICOLON);
+// Splits the source in at most `count` pieces of similar size, each one
+// ending right after a top-level `;`. Returns the number of pieces.
+static uint32_t split_source(string_view_t source, uint32_t* ends, uint32_t count) {
+    const char* const data = string_view_data(source);
+    const uint32_t size = (uint32_t)string_view_size(source);
+
+    uint32_t n = 0;
+    uint32_t target = size / count;
+    int depth = 0;
+
+    for(const char* it = data; n + 1 < count && *it != '\0'; it++) {
+        switch(*it) {
+            case '#':
+                it = scan.find_line_end(it) - 1;
+                break;
+            case '{':
+                depth++;
+                break;
+            case '}':
+                depth--;
+                break;
+            case ';': {
+                const uint32_t end = (uint32_t)(it - data) + 1;
+
+                if(depth == 0 && end >= target && ends_declaration(it + 1)) {
+                    ends[n++] = end;
+                    target = (uint64_t)size * (n + 1) / count;
+                }
+                break;
+            }
+        }
+    }
 
-    return make_expr_stmt(expr);
+    ends[n++] = size;
+    return n;
 }
 
-static const ast_node_t* parse_if_statement(parser_t* p) {
-    const ast_node_t* const condition = parse_expression(p);
-    
-    parser_consume(p, THEN_KEYWORD);
-    const ast_node_t* const then = parse_statement(p);
+static int parse_job(void* arg) {
+    parse_job_t* const job = arg;
+    arena_t* const prev = use_arena(job->arena);
+
+    // Kept in the job, it must survive the jump.
+    parser_t* const p = &job->parser;
 
-    const ast_node_t* otherwise = NULL;
-    if(parser_match(p, ELSE_KEYWORD)) {
-        otherwise = parse_statement(p);
+    jmp_buf on_error;
+    *p = (parser_t) {
+        .lexer = INIT_LEXER(job->source),
+        .tokens = NULL,
+        .first_line = 1,
+        .on_error = &on_error
+    };
+
+    p->lexer.current = job->begin;
+
+    if(setjmp(on_error) != 0) {
+        job->failed = true;
+
+        destroy_parser(p);
+        use_arena(prev);
+
+        return 0;
     }
 
-    return make_if_stmt(condition, then, otherwise);
-}
+    p->curr = next_token(&p->lexer);
+    job->first_token = p->curr.start;
+
+    while(p->curr.type != TOK_EOF && p->curr.start < job->end) {
+        ast_node_t* const decl = (ast_node_t*)parse_decl(p);
 
-static inline const ast_node_t* parse_statement(parser_t* p) {
+        if(job->last != NULL) {
+            job->last->next = decl;
+        } else {
+            job->first = decl;
+        }
 
-    if(parser_match(p, IF_KEYWORD)) {
-        return parse_if_statement(p);
+        job->last = decl;
     }
 
-    return parse_expr_statement(p);
+    job->stop = p->curr.start;
+
+    destroy_parser(p);
+    use_arena(prev);
+
+    return 0;
 }
 
-static inline const ast_node_t* parse_decl(parser_t* p) {
-    if(parser_match(p, VAR_KEYWORD) || parser_match(p, LET_KEYWORD)) {
-        return parse_var_declaration(p);
+const ast_node_t* parse_program_parallel(string_view_t source, int jobs) {
+    if(jobs < 1) jobs = 1;
+
+    arena_t* const arena = active_arena();
+
+    uint32_t* const ends = MALLOC(uint32_t*, sizeof(uint32_t) * jobs);
+    const uint32_t count = split_source(source, ends, (uint32_t)jobs);
+
+    parse_job_t* const work = MALLOC(parse_job_t*, sizeof(parse_job_t) * count);
+    thrd_t* const threads = MALLOC(thrd_t*, sizeof(thrd_t) * count);
+
+    for(uint32_t i = 0; i < count; i++) {
+        work[i] = (parse_job_t) {
+            .source = source,
+            .begin = i > 0 ? ends[i - 1] : 0,
+            .end = ends[i],
+            .arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE)
+        };
     }
 
-    return parse_statement(p);
-}
+    // The first piece is parsed by the calling thread.
+    for(uint32_t i = 1; i < count; i++) {
+        if(thrd_create(&threads[i], parse_job, &work[i]) != thrd_success) {
+            fprintf(stderr, "Couldn't start the parser threads.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-const ast_node_t* parse_program(parser_t* p) {
+    parse_job(&work[0]);
 
-    ast_node_t* program = (ast_node_t*) parse_decl(p);
-    ast_node_t* curr = program;
+    for(uint32_t i = 1; i < count; i++) {
+        thrd_join(threads[i], NULL);
+    }
 
-    while(PARSER_CURR(p).type != TOK_EOF) {
-        ast_node_t* node = (ast_node_t*)parse_decl(p);
-        curr->next = node;
-        curr = node;
+    // The pieces only fail to line up when a declaration crosses a `;`,
+    // which is a syntax error.
+    bool is_valid = work[0].first != NULL;
+    for(uint32_t i = 0; i < count; i++) {
+        is_valid = is_valid && !work[i].failed &&
+            (i + 1 == count || work[i].stop == work[i + 1].first_token);
     }
 
-    return program;
+    if(!is_valid) {
+        for(uint32_t i = 0; i < count; i++) {
+            destroy_arena(work[i].arena);
+        }
+
+        // Parsed again on this thread, to report the first error.
+        parser_t p = init_parser(source);
+        const ast_node_t* const program = parse_program(&p);
+
+        destroy_parser(&p);
+        return program;
+    }
+
+    ast_node_t* last = NULL;
+    for(uint32_t i = 0; i < count; i++) {
+        if(work[i].first != NULL) {
+            if(last != NULL) {
+                last->next = work[i].first;
+            }
+
+            last = work[i].last;
+        }
+
+        arena_merge(arena, work[i].arena);
+    }
+
+    return work[0].first;
 }
@@ -0,0 +1,205 @@
+#include "../include/scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// =============== Scalar ===============
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool is_alpha(char c) {
+    return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a';
+}
+
+static inline bool is_digit(char c) {
+    return (unsigned char)(c - '0') <= 9;
+}
+
+static const char* scalar_skip_blanks(const char* p) {
+    while(is_blank(*p)) p++;
+    return p;
+}
+
+static const char* scalar_find_line_end(const char* p) {
+    while(*p != '\n' && *p != '\0') {
+        p++;
+    }
+
+    return p;
+}
+
+static const char* scalar_skip_alnum(const char* p) {
+    while(is_alpha(*p) || is_digit(*p)) p++;
+    return p;
+}
+
+static const char* scalar_skip_digits(const char* p) {
+    while(is_digit(*p)) p++;
+    return p;
+}
+
+#ifdef HAS_X86_KERNELS
+
+// =============== SSE2 ===============
+
+#define SSE2_RANGE(v, lo, hi)                                           \
+    _mm_and_si128(_mm_cmpgt_epi8((v), _mm_set1_epi8((char)((lo) - 1))), \
+                  _mm_cmplt_epi8((v), _mm_set1_epi8((char)((hi) + 1))))
+
+__attribute__((target("sse2")))
+static const char* sse2_skip_blanks(const char* p) {
+    for(;; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+        const __m128i blank = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+        const uint32_t others = ~(uint32_t)_mm_movemask_epi8(blank) & 0xFFFF;
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+__attribute__((target("sse2")))
+static const char* sse2_find_line_end(const char* p) {
+    for(;; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                         _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+
+        if(mask != 0) return p + __builtin_ctz(mask);
+    }
+}
+
+__attribute__((target("sse2")))
+static const char* sse2_skip_alnum(const char* p) {
+    for(;; p += 16) {
+        // Setting 0x20 lowers the letters, the digits are tested on the bytes
+        // as they are, since it also maps 0x10-0x19 onto them.
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        const __m128i alnum = _mm_or_si128(SSE2_RANGE(lower, 'a', 'z'), SSE2_RANGE(v, '0', '9'));
+        const uint32_t others = ~(uint32_t)_mm_movemask_epi8(alnum) & 0xFFFF;
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+__attribute__((target("sse2")))
+static const char* sse2_skip_digits(const char* p) {
+    for(;; p += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+        const uint32_t others = ~(uint32_t)_mm_movemask_epi8(SSE2_RANGE(v, '0', '9')) & 0xFFFF;
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+#undef SSE2_RANGE
+
+// =============== AVX2 ===============
+
+#define AVX2_RANGE(v, lo, hi)                                                   \
+    _mm256_andnot_si256(                                                        \
+        _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8((char)(lo)), (v)),   \
+                        _mm256_cmpgt_epi8((v), _mm256_set1_epi8((char)(hi)))),  \
+        _mm256_set1_epi8(-1))
+
+__attribute__((target("avx2")))
+static const char* avx2_skip_blanks(const char* p) {
+    for(;; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        const __m256i blank = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+
+        const uint32_t others = ~(uint32_t)_mm256_movemask_epi8(blank);
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_find_line_end(const char* p) {
+    for(;; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+
+        if(mask != 0) return p + __builtin_ctz(mask);
+    }
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_skip_alnum(const char* p) {
+    for(;; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        const __m256i alnum = _mm256_or_si256(AVX2_RANGE(lower, 'a', 'z'), AVX2_RANGE(v, '0', '9'));
+        const uint32_t others = ~(uint32_t)_mm256_movemask_epi8(alnum);
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_skip_digits(const char* p) {
+    for(;; p += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        const uint32_t others = ~(uint32_t)_mm256_movemask_epi8(AVX2_RANGE(v, '0', '9'));
+
+        if(others != 0) return p + __builtin_ctz(others);
+    }
+}
+
+#undef AVX2_RANGE
+
+#endif
+
+// =============== Dispatch ===============
+
+scan_kernels_t scan = {
+    .skip_blanks = scalar_skip_blanks,
+    .find_line_end = scalar_find_line_end,
+    .skip_alnum = scalar_skip_alnum,
+    .skip_digits = scalar_skip_digits
+};
+
+void select_scan_kernels() {
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        scan = (scan_kernels_t) {
+            .skip_blanks = avx2_skip_blanks,
+            .find_line_end = avx2_find_line_end,
+            .skip_alnum = avx2_skip_alnum,
+            .skip_digits = avx2_skip_digits
+        };
+        return;
+    }
+
+    if(__builtin_cpu_supports("sse2")) {
+        scan = (scan_kernels_t) {
+            .skip_blanks = sse2_skip_blanks,
+            .find_line_end = sse2_find_line_end,
+            .skip_alnum = sse2_skip_alnum,
+            .skip_digits = sse2_skip_digits
+        };
+        return;
+    }
+#endif
+}
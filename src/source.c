@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+
+#include "../include/source.h"
+#include "../include/lexer.h"
+#include "../include/memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define EXIT_WITH_ERROR(path)                   \
+    do {                                        \
+        perror((path));                         \
+        exit(EXIT_FAILURE);                     \
+    } while(0)
+
+static void check_source_size(const char* path, size_t size) {
+    // Tokens address the source with 32-bit offsets.
+    if(size >= UINT32_MAX) {
+        fprintf(stderr, "%s: file too large.\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static source_file_t map_source_file(const char* path, int fd, size_t size, bool populate) {
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t capacity = (size + 1 + LEXER_PADDING + page_size - 1) / page_size * page_size;
+
+    // Reserve zeroed pages for the whole text plus the sentinel, then map the
+    // file over the beginning. The tail of the last file page is zero filled
+    // by the kernel as well.
+    char* const data = mmap(NULL, capacity, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(data == MAP_FAILED) EXIT_WITH_ERROR(path);
+
+    if(size > 0) {
+        int flags = MAP_PRIVATE | MAP_FIXED;
+#ifdef MAP_POPULATE
+        if(populate) flags |= MAP_POPULATE;
+#else
+        (void)populate;
+#endif
+
+        if(mmap(data, size, PROT_READ, flags, fd, 0) == MAP_FAILED) EXIT_WITH_ERROR(path);
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    return (source_file_t) {
+        .text = new_string_view(data, size),
+        .data = data,
+        .capacity = capacity,
+        .is_mapped = true
+    };
+}
+
+static source_file_t read_source_file(const char* path, int fd) {
+    size_t capacity = 64 * 1024;
+    size_t size = 0;
+
+    char* data = malloc(capacity);
+    if(data == NULL) EXIT_WITH_ERROR(path);
+
+    for(;;) {
+        if(capacity - size <= 1 + LEXER_PADDING) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if(data == NULL) EXIT_WITH_ERROR(path);
+        }
+
+        const ssize_t n = read(fd, data + size, capacity - size - 1 - LEXER_PADDING);
+        if(n == 0) break;
+
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            EXIT_WITH_ERROR(path);
+        }
+
+        size += (size_t)n;
+        check_source_size(path, size);
+    }
+
+    memset(data + size, 0, 1 + LEXER_PADDING);
+
+    return (source_file_t) {
+        .text = new_string_view(data, size),
+        .data = data,
+        .capacity = capacity,
+        .is_mapped = false
+    };
+}
+
+source_file_t open_source_file(const char* path, bool populate) {
+    const bool is_stdin = strcmp(path, "-") == 0;
+
+    const int fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if(fd < 0) EXIT_WITH_ERROR(path);
+
+    struct stat info;
+    if(fstat(fd, &info) < 0) EXIT_WITH_ERROR(path);
+
+    source_file_t file;
+    if(S_ISREG(info.st_mode)) {
+        check_source_size(path, (size_t)info.st_size);
+        file = map_source_file(path, fd, (size_t)info.st_size, populate);
+    } else {
+        file = read_source_file(path, fd);
+    }
+
+    if(!is_stdin) {
+        close(fd);
+    }
+
+    return file;
+}
+
+source_stream_t open_source_stream(const char* path) {
+    const bool is_stdin = strcmp(path, "-") == 0;
+
+    const int fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if(fd < 0) EXIT_WITH_ERROR(path);
+
+    return (source_stream_t) {
+        .path = path,
+        .fd = fd
+    };
+}
+
+size_t source_stream_read(source_stream_t* stream, char* buffer, size_t size) {
+    for(;;) {
+        const ssize_t n = read(stream->fd, buffer, size);
+        if(n >= 0) return (size_t)n;
+
+        if(errno != EINTR) EXIT_WITH_ERROR(stream->path);
+    }
+}
+
+void close_source_stream(source_stream_t* stream) {
+    if(stream->fd != STDIN_FILENO) {
+        close(stream->fd);
+    }
+
+    stream->fd = -1;
+}
+
+#undef EXIT_WITH_ERROR
+
+void close_source_file(source_file_t* file) {
+    if(file->is_mapped) {
+        munmap(file->data, file->capacity);
+    } else {
+        free(file->data);
+    }
+
+    file->data = NULL;
+    file->text = STRING_VIEW_EMPTY;
+}
+
+typedef struct {
+    arena_t* arena;
+
+    string_view_t source;
+    uint32_t* newlines;
+    size_t count;
+} newline_index_t;
+
+static newline_index_t newline_index = {0};
+
+static void build_newline_index(string_view_t source) {
+    if(newline_index.arena == NULL) {
+        newline_index.arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE);
+    } else {
+        arena_reset(newline_index.arena);
+    }
+
+    const char* const data = string_view_data(source);
+    const size_t size = string_view_size(source);
+
+    size_t count = 0;
+    for(const char* it = data; (it = memchr(it, '\n', size - (it - data))) != NULL; it++) {
+        count++;
+    }
+
+    newline_index.newlines = ARENA_MALLOC(newline_index.arena, uint32_t*, sizeof(uint32_t) * (count + 1));
+    newline_index.count = 0;
+
+    for(const char* it = data; (it = memchr(it, '\n', size - (it - data))) != NULL; it++) {
+        newline_index.newlines[newline_index.count++] = (uint32_t)(it - data);
+    }
+
+    newline_index.source = source;
+}
+
+source_location_t source_location(string_view_t source, uint32_t offset) {
+    if(newline_index.source.data != source.data || newline_index.source.count != source.count) {
+        build_newline_index(source);
+    }
+
+    // Number of newlines before the offset.
+    size_t low = 0;
+    size_t high = newline_index.count;
+    while(low < high) {
+        const size_t mid = low + (high - low) / 2;
+
+        if(newline_index.newlines[mid] < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    const uint32_t line_start = low > 0 ? newline_index.newlines[low - 1] + 1 : 0;
+
+    return (source_location_t) {
+        .line = (int)low + 1,
+        .column = (int)(offset - line_start) + 1
+    };
+}
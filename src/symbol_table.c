@@ -1,35 +1,74 @@
 #include "../include/symbol_table.h"
 #include "../include/memory.h"
 
+#include <string.h>
+
+static void grow_symbol_table(symbol_table_t* symtbl, size_t min_capacity) {
+    size_t capacity = symtbl->capacity;
+    while(capacity < min_capacity) {
+        capacity *= 2;
+    }
+
+    symbol_t* const symbols = ARENA_MALLOC(symtbl->arena, symbol_t*, sizeof(symbol_t) * capacity);
+    memcpy(symbols, symtbl->symbols, sizeof(symbol_t) * symtbl->capacity);
+
+    for(size_t i = symtbl->capacity; i < capacity; i++) {
+        symbols[i].slot = SYMBOL_NO_SLOT;
+    }
+
+    symtbl->symbols = symbols;
+    symtbl->capacity = capacity;
+}
+
 inline symbol_table_t* create_symbol_table() {
-    symbol_table_t* symtbl = MALLOC(symbol_table_t*, sizeof(symbol_table_t));
-    symtbl->end = symtbl->start = NULL;
+    arena_t* const arena = create_arena(0);
+
+    symbol_table_t* symtbl = ARENA_MALLOC(arena, symbol_table_t*, sizeof(symbol_table_t));
+
+    symtbl->arena = arena;
+    symtbl->capacity = SYMBOL_TABLE_INITIAL_CAPACITY;
+    symtbl->symbols = ARENA_MALLOC(arena, symbol_t*, sizeof(symbol_t) * symtbl->capacity);
+    symtbl->slot_count = 0;
+
+    for(size_t i = 0; i < symtbl->capacity; i++) {
+        symtbl->symbols[i].slot = SYMBOL_NO_SLOT;
+    }
 
     return symtbl;
 }
 
-void symbol_table_put(symbol_table_t* symtbl, string_view_t name, const type_t* type) {
-    symbol_entry_t* entry = MALLOC(symbol_entry_t*, sizeof(symbol_entry_t));
-    
-    entry->name = name;
-    entry->type = type;
-    entry->next = NULL;
-
-    if(symtbl->start == NULL) {
-        symtbl->start = entry;
-        symtbl->end = symtbl->start;
-    } else {
-        symtbl->end->next = entry;
-        symtbl->end = symtbl->end->next;
-    }
+void destroy_symbol_table(symbol_table_t* symtbl) {
+    destroy_arena(symtbl->arena);
 }
 
-const type_t* symbol_table_search(symbol_table_t* symtbl, string_view_t name) {
-    for(const symbol_entry_t* it = symtbl->start; it != NULL; it = it->next) {
-        if(string_view_equal(it->name, name)) {
-            return it->type;
-        }
+static inline const type_t* bind_symbol(symbol_table_t* symtbl, intern_id_t name,
+                                        const type_t* type, uint32_t slot) {
+    if(name >= symtbl->capacity) {
+        grow_symbol_table(symtbl, (size_t)name + 1);
     }
 
-    return NULL;
+    const type_t* const shadowed = symtbl->symbols[name].type;
+    symtbl->symbols[name] = (symbol_t) {
+        .type = type,
+        .slot = slot
+    };
+
+    return shadowed;
+}
+
+const type_t* symbol_table_put(symbol_table_t* symtbl, intern_id_t name, const type_t* type) {
+    return bind_symbol(symtbl, name, type, SYMBOL_NO_SLOT);
+}
+
+uint32_t symbol_table_declare(symbol_table_t* symtbl, intern_id_t name, const type_t* type) {
+    const uint32_t slot = symtbl->slot_count++;
+    bind_symbol(symtbl, name, type, slot);
+
+    return slot;
+}
+
+symbol_t symbol_table_search(symbol_table_t* symtbl, intern_id_t name) {
+    return name < symtbl->capacity
+        ? symtbl->symbols[name]
+        : (symbol_t) { .type = NULL, .slot = SYMBOL_NO_SLOT };
 }
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 
 typedef enum {
     TCHECK_INVALID_ASSIGNMENT,
@@ -27,21 +28,29 @@ static const char* typechecker_error_messages[] = {
     [TCHECK_EXPECT_VALID_INDEX] = "Expected a valid index for array access." 
 };
 
+#define SCRATCH_CHUNK_SIZE (4 * 1024)
+
 typechecker_t create_typechecker() {
 
     symbol_table_t* symtbl = create_symbol_table();
 
-    symbol_table_put(symtbl, new_string_view_from_cstr("integer"), int_type);
-    symbol_table_put(symtbl, new_string_view_from_cstr("float"), float_type);
-    symbol_table_put(symtbl, new_string_view_from_cstr("bool"), bool_type);
+    symbol_table_put(symtbl, intern(new_string_view_from_cstr("integer")), int_type);
+    symbol_table_put(symtbl, intern(new_string_view_from_cstr("float")), float_type);
+    symbol_table_put(symtbl, intern(new_string_view_from_cstr("bool")), bool_type);
 
     return (typechecker_t) {
         .symtbl = symtbl,
+        .scratch = create_arena(SCRATCH_CHUNK_SIZE),
         .current = NULL,
         .had_error = false
     };
 }
 
+void destroy_typechecker(typechecker_t* tcheck) {
+    destroy_symbol_table(tcheck->symtbl);
+    destroy_arena(tcheck->scratch);
+}
+
 static inline void typechecker_error(typechecker_t *tcheck, typechecker_error_t err) {
     if(!tcheck->had_error) {
         tcheck->had_error = true;
@@ -51,192 +60,725 @@ static inline void typechecker_error(typechecker_t *tcheck, typechecker_error_t
 }
 
 #define SET_RESULT_TYPE(tcheck, result) ((tcheck)->current = result)
-#define GET_TYPE_OF(expr, tcheck) (typecheck_node((expr), (tcheck)), (tcheck)->current)
 
-static void typecheck_node(const ast_node_t* node, typechecker_t* tcheck) {
+// The result is also kept in the node, for the passes after the typechecker.
+#define SET_NODE_TYPE(tcheck, node, result) (((ast_node_t*)(node))->type = SET_RESULT_TYPE(tcheck, result))
+
+// =============== Traversal stack ===============
+// Nodes are checked in post-order without recursion. Each frame records how
+// many of its children were already checked (`stage`), the result of the
+// last one is in `tcheck->current`.
+
+typedef struct {
+    union {
+        const ast_node_t* node;
+        node_ref_t ref;
+    };
+
+    // Next element of an initializer.
+    union {
+        const ast_node_t* it;
+        uint32_t element;
+    };
+
+    // Type of the first operand, or of the previous element.
+    const type_t* saved;
+    int count;
+
+    uint8_t stage;
+} tcheck_frame_t;
+
+typedef struct {
+    tcheck_frame_t* items;
+    uint32_t count;
+    uint32_t capacity;
+} tcheck_stack_t;
+
+#define INITIAL_FRAMES 64
+
+// The frames live in the scratch arena. The initial ones are allocated
+// before the mark, the bigger copies are released after each declaration.
+static inline tcheck_stack_t create_tcheck_stack(typechecker_t* tcheck) {
+    return (tcheck_stack_t) {
+        .items = ARENA_MALLOC(tcheck->scratch, tcheck_frame_t*, sizeof(tcheck_frame_t) * INITIAL_FRAMES),
+        .count = 0,
+        .capacity = INITIAL_FRAMES
+    };
+}
+
+#undef INITIAL_FRAMES
+
+static void grow_tcheck_stack(typechecker_t* tcheck, tcheck_stack_t* stack) {
+    tcheck_frame_t* const items = ARENA_MALLOC(tcheck->scratch, tcheck_frame_t*,
+                                               sizeof(tcheck_frame_t) * stack->capacity * 2);
+    memcpy(items, stack->items, sizeof(tcheck_frame_t) * stack->count);
+
+    stack->items = items;
+    stack->capacity *= 2;
+}
+
+static inline tcheck_frame_t* push_tcheck_frame(typechecker_t* tcheck, tcheck_stack_t* stack) {
+    if(stack->count == stack->capacity) {
+        grow_tcheck_stack(tcheck, stack);
+    }
+
+    tcheck_frame_t* const frame = &stack->items[stack->count++];
+    frame->stage = 0;
+
+    return frame;
+}
+
+// Variables and literals are resolved in place, without a frame of their own.
+// The parent frame then continues with its next stage.
+#define PUSH_NODE(tcheck, stack, child)                                     \
+    do {                                                                    \
+        if(!typecheck_leaf((child), (tcheck))) {                            \
+            push_tcheck_frame((tcheck), (stack))->node = (child);           \
+        }                                                                   \
+    } while(0)
+
+#define PUSH_REF(tcheck, stack, ast, child)                                 \
+    do {                                                                    \
+        if(!typecheck_flat_leaf((ast), (child), (tcheck))) {                \
+            push_tcheck_frame((tcheck), (stack))->ref = (child);            \
+        }                                                                   \
+    } while(0)
+
+// Type reached by `dimensions` subscripts, NULL when `type` has fewer dimensions.
+static inline const type_t* element_type(const type_t* type, int dimensions) {
+    for(int i = 0; i < dimensions; i++) {
+        if(type->kind != TYPE_ARRAY) return NULL;
+        type = type->underlying;
+    }
 
+    return type;
+}
+
+// =============== AST ===============
+
+static inline bool typecheck_leaf(const ast_node_t* node, typechecker_t* tcheck) {
     switch(node->kind) {
-        case VARIABLE_DECL_NODE: {
-            const variable_decl_t* const decl = (variable_decl_t*)node;
-            
-            const type_t* t = decl->is_type_inferred
-                ? GET_TYPE_OF(decl->rvalue, tcheck)
-                : decl->type;
-                
-            symbol_table_put(tcheck->symtbl, decl->name.lexeme, t);
-
-            if(decl->rvalue != NULL && !decl->is_type_inferred) {
-                if(!are_types_equal(GET_TYPE_OF(decl->rvalue, tcheck), t)) {
+        case VARIABLE_EXPR_NODE: {
+            variable_expr_t* const var = (variable_expr_t*)node;
+            const symbol_t symbol = symbol_table_search(tcheck->symtbl, var->name.id);
+
+            var->slot = symbol.slot;
+            SET_NODE_TYPE(tcheck, node, symbol.type);
+            return true;
+        }
+        case LITERAL_NODE:
+            SET_NODE_TYPE(tcheck, node, ((literal_expr_t*)node)->type);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// `stack` is passed by value, a grown copy is dropped with the scratch arena.
+static void typecheck_node(const ast_node_t* root, typechecker_t* tcheck, tcheck_stack_t stack) {
+
+    PUSH_NODE(tcheck, &stack, root);
+
+    while(stack.count > 0) {
+        tcheck_frame_t* const frame = &stack.items[stack.count - 1];
+        const ast_node_t* const node = frame->node;
+
+        switch(node->kind) {
+            case VARIABLE_DECL_NODE: {
+                variable_decl_t* const decl = (variable_decl_t*)node;
+
+                if(frame->stage++ == 0) {
+                    if(decl->is_type_inferred) {
+                        PUSH_NODE(tcheck, &stack, decl->rvalue);
+                        continue;
+                    }
+
+                    decl->slot = symbol_table_declare(tcheck->symtbl, decl->name.id, decl->type);
+
+                    if(decl->rvalue != NULL) {
+                        PUSH_NODE(tcheck, &stack, decl->rvalue);
+                        continue;
+                    }
+
+                    break;
+                }
+
+                if(decl->is_type_inferred) {
+                    decl->slot = symbol_table_declare(tcheck->symtbl, decl->name.id, tcheck->current);
+                } else if(!are_types_equal(tcheck->current, decl->type)) {
                     typechecker_error(tcheck, TCHECK_VARIABLE_INIT_ERROR);
-                    return;
                 }
+
+                break;
             }
+            case IF_STATEMENT_NODE: {
+                const if_statement_t* const stmt = (if_statement_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_NODE(tcheck, &stack, stmt->condition);
+                        continue;
+                    case 1:
+                        if(!are_types_equal(tcheck->current, bool_type)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_BOOLEAN);
+                            break;
+                        }
+
+                        PUSH_NODE(tcheck, &stack, stmt->then);
+                        continue;
+                    case 2:
+                        if(stmt->otherwise != NULL) {
+                            PUSH_NODE(tcheck, &stack, stmt->otherwise);
+                            continue;
+                        }
+
+                        break;
+                }
 
-            break;
-        }
-        case IF_STATEMENT_NODE: {
-            const if_statement_t* const stmt = (if_statement_t*)node;
+                break;
+            }
+            case EXPR_STATEMENT_NODE: {
+                const expr_statement_t* const stmt = (expr_statement_t*)node;
+
+                if(frame->stage++ == 0) {
+                    PUSH_NODE(tcheck, &stack, stmt->expr);
+                    continue;
+                }
 
-            if(!are_types_equal(GET_TYPE_OF(stmt->condition, tcheck), bool_type)) {
-                typechecker_error(tcheck, TCHECK_EXPECT_BOOLEAN);
-                return;
+                break;
             }
+            case ASSIGN_EXPR_NODE: {
+
+                const assign_expr_t* const expr = (assign_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_NODE(tcheck, &stack, expr->lvalue);
+                        continue;
+                    case 1:
+                        frame->saved = tcheck->current;
+                        PUSH_NODE(tcheck, &stack, expr->rvalue);
+                        continue;
+                }
 
-            GET_TYPE_OF(stmt->then, tcheck);
+                const type_t* left = frame->saved;
+                const type_t* right = tcheck->current;
 
-            if(stmt->otherwise != NULL) {
-                GET_TYPE_OF(stmt->otherwise, tcheck);
+                if(!are_types_equal(right, left)) {
+                    typechecker_error(tcheck, TCHECK_INVALID_ASSIGNMENT);
+                    break;
+                }
+
+                SET_NODE_TYPE(tcheck, node, left);
+                break;
             }
+            case BINARY_EXPR_NODE: {
+
+                const binary_expr_t* const expr = (binary_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_NODE(tcheck, &stack, expr->left);
+                        continue;
+                    case 1:
+                        frame->saved = tcheck->current;
+                        PUSH_NODE(tcheck, &stack, expr->right);
+                        continue;
+                }
 
-            break;
-        }
-        case EXPR_STATEMENT_NODE: {
-            const expr_statement_t* const stmt = (expr_statement_t*)node;
-            SET_RESULT_TYPE(tcheck, GET_TYPE_OF(stmt->expr, tcheck));
-            break;
-        }
-        case ASSIGN_EXPR_NODE: {
+                const type_t* left = frame->saved;
+                const type_t* right = tcheck->current;
+
+                if(!IS_NUMERIC_TYPE(left) || !IS_NUMERIC_TYPE(right)) {
+                    typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
+                    break;
+                }
 
-            const assign_expr_t* const expr = (assign_expr_t*)node;
+                switch(expr->op.type) {
+                    case PLUS:
+                    case MINUS:
+                    case STAR:
+                    case SLASH: {
+                        const type_t* result = cast_to_bigger(left, right);
+                        if(result == NULL) {
+                            typechecker_error(tcheck, TCHECK_CAST_ERROR);
+                            break;
+                        }
+
+                        SET_NODE_TYPE(tcheck, node, result);
+                        break;
+                    }
+                    case LESS:
+                    case GREATER:
+                    case GREATER_EQ:
+                    case LESS_EQ:
+                        SET_NODE_TYPE(tcheck, node, bool_type);
+                        break;
+                    default:
+                        break;
+                }
+
+                break;
+            }
+            case UNARY_EXPR_NODE: {
+
+                const unary_expr_t* const expr = (unary_expr_t*)node;
 
-            const type_t* left = GET_TYPE_OF(expr->lvalue, tcheck);
-            const type_t* right = GET_TYPE_OF(expr->rvalue, tcheck);
+                if(frame->stage++ == 0) {
+                    PUSH_NODE(tcheck, &stack, expr->right);
+                    continue;
+                }
 
-            if(!are_types_equal(right, left)) {
-                typechecker_error(tcheck, TCHECK_INVALID_ASSIGNMENT);
-                return;
+                if(!IS_NUMERIC_TYPE(tcheck->current)) {
+                    typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
+                    break;
+                }
+
+                SET_NODE_TYPE(tcheck, node, tcheck->current);
+                break;
             }
+            case CASTING_EXPR_NODE: {
 
-            SET_RESULT_TYPE(tcheck, left);
-            break;
-        }
-        case BINARY_EXPR_NODE: {
+                const casting_expr_t* const expr = (casting_expr_t*)node;
 
-            const binary_expr_t* const expr = (binary_expr_t*)node;
+                if(frame->stage++ == 0) {
+                    PUSH_NODE(tcheck, &stack, expr->expr);
+                    continue;
+                }
 
-            const type_t* left = GET_TYPE_OF(expr->left, tcheck);
-            const type_t* right = GET_TYPE_OF(expr->right, tcheck);
+                if (!can_cast_to(tcheck->current, expr->target_type)) {
+                    typechecker_error(tcheck, TCHECK_CAST_ERROR);
+                    break;
+                }
+
+                SET_NODE_TYPE(tcheck, node, expr->target_type);
+                break;
+            }
+            case SUBSCRIPT_EXPR_NODE: {
+
+                const subscript_expr_t* const expr = (subscript_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_NODE(tcheck, &stack, expr->lvalue);
+                        continue;
+                    case 1:
+                        if(tcheck->current->kind != TYPE_ARRAY) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_ARRAY);
+                            break;
+                        }
+
+                        frame->saved = tcheck->current;
+                        PUSH_NODE(tcheck, &stack, expr->index);
+                        continue;
+                    case 2:
+                        if(!IS_INTEGER_TYPE(tcheck->current)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_VALID_INDEX);
+                            break;
+                        }
+
+                        SET_NODE_TYPE(tcheck, node, frame->saved->underlying);
+                        break;
+                }
 
-            if(!IS_NUMERIC_TYPE(left) || !IS_NUMERIC_TYPE(right)) {
-                typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
-                return;
+                break;
             }
+            case ELEMENT_EXPR_NODE: {
+
+                const element_expr_t* const expr = (element_expr_t*)node;
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_NODE(tcheck, &stack, expr->array);
+                        continue;
+                    case 1:
+                        frame->saved = element_type(tcheck->current, expr->dimensions);
+                        if(frame->saved == NULL) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_ARRAY);
+                            break;
+                        }
+
+                        PUSH_NODE(tcheck, &stack, expr->offset);
+                        continue;
+                    case 2:
+                        if(!are_types_equal(tcheck->current, int_type)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_VALID_INDEX);
+                            break;
+                        }
+
+                        SET_NODE_TYPE(tcheck, node, frame->saved);
+                        break;
+                }
 
-            switch(expr->op.type) {
-                case PLUS:
-                case MINUS:
-                case STAR:
-                case SLASH: {
-                    const type_t* result = cast_to_bigger(left, right);
-                    if(result == NULL) {
-                        typechecker_error(tcheck, TCHECK_CAST_ERROR);
-                        return;
+                break;
+            }
+            case INITIALIZER_NODE: {
+
+                const initializer_t* const initializer = (initializer_t*)node;
+
+                if(frame->stage == 0) {
+                    // Not counted in `stage`, a list can have more elements than it holds.
+                    frame->stage = 1;
+                    frame->it = initializer->init;
+                    frame->saved = NULL;
+                    frame->count = 0;
+                } else {
+                    const type_t* type = tcheck->current;
+
+                    if(frame->saved != NULL && !are_types_equal(frame->saved, type)) {
+                        typechecker_error(tcheck, TCHECK_INITIALIZER_NOT_UNIFORM);
+                        break;
                     }
 
-                    SET_RESULT_TYPE(tcheck, result);
-                    break;
+                    frame->saved = type;
+                    frame->it = frame->it->next;
+                    frame->count++;
                 }
-                case LESS:
-                case GREATER:
-                case GREATER_EQ:
-                case LESS_EQ:
-                    SET_RESULT_TYPE(tcheck, bool_type);
-                    break;
-                default:
-                    break;
+
+                if(frame->it != NULL) {
+                    PUSH_NODE(tcheck, &stack, frame->it);
+                    continue;
+                }
+
+                SET_NODE_TYPE(tcheck, node, create_array_type(frame->saved, frame->count));
+                break;
             }
-            
-            break;
+            default:
+                // Leaves never get a frame.
+                break;
         }
-        case UNARY_EXPR_NODE: {
 
-            const unary_expr_t* const expr = (unary_expr_t*)node;
+        // Checked, or stopped at the first error.
+        stack.count--;
+    }
+}
+
+bool typecheck_decl(const ast_node_t* decl, typechecker_t* tcheck) {
+
+    const arena_mark_t mark = arena_mark(tcheck->scratch);
+
+    typecheck_node(decl, tcheck, create_tcheck_stack(tcheck));
+    arena_rollback(tcheck->scratch, mark);
+
+    return !tcheck->had_error;
+}
+
+bool typecheck_ast(const ast_node_t* ast, typechecker_t* tcheck) {
+
+    const tcheck_stack_t stack = create_tcheck_stack(tcheck);
+    const arena_mark_t mark = arena_mark(tcheck->scratch);
+
+    for (const ast_node_t *it = ast; it != NULL; it = it->next){
+        typecheck_node(it, tcheck, stack);
+        arena_rollback(tcheck->scratch, mark);
+    }
+
+    return !tcheck->had_error;
+}
+
+// =============== Flat AST ===============
 
-            const type_t* right = GET_TYPE_OF(expr->right, tcheck);
+static inline bool typecheck_flat_leaf(const flat_ast_t* ast, node_ref_t ref, typechecker_t* tcheck) {
+    const uint32_t index = NODE_REF_INDEX(ref);
 
-            if(!IS_NUMERIC_TYPE(right)) {
-                typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
-                return;
+    switch(NODE_REF_KIND(ref)) {
+        case VARIABLE_EXPR_NODE:
+            SET_RESULT_TYPE(tcheck, symbol_table_search(tcheck->symtbl, ast->variable_exprs.items[index].name).type);
+            return true;
+        case LITERAL_NODE:
+            SET_RESULT_TYPE(tcheck, type_from_id(ast->literal_exprs.items[index].type));
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void typecheck_flat_node(const flat_ast_t* ast, node_ref_t root, typechecker_t* tcheck,
+                                tcheck_stack_t stack) {
+
+    PUSH_REF(tcheck, &stack, ast, root);
+
+    while(stack.count > 0) {
+        tcheck_frame_t* const frame = &stack.items[stack.count - 1];
+        const uint32_t index = NODE_REF_INDEX(frame->ref);
+
+        switch(NODE_REF_KIND(frame->ref)) {
+            case VARIABLE_DECL_NODE: {
+                const flat_variable_decl_t* const decl = &ast->variable_decls.items[index];
+
+                if(frame->stage++ == 0) {
+                    if(decl->is_type_inferred) {
+                        PUSH_REF(tcheck, &stack, ast, decl->rvalue);
+                        continue;
+                    }
+
+                    symbol_table_declare(tcheck->symtbl, decl->name, type_from_id(decl->type));
+
+                    if(decl->rvalue != NULL_NODE_REF) {
+                        PUSH_REF(tcheck, &stack, ast, decl->rvalue);
+                        continue;
+                    }
+
+                    break;
+                }
+
+                if(decl->is_type_inferred) {
+                    symbol_table_declare(tcheck->symtbl, decl->name, tcheck->current);
+                } else if(!are_types_equal(tcheck->current, type_from_id(decl->type))) {
+                    typechecker_error(tcheck, TCHECK_VARIABLE_INIT_ERROR);
+                }
+
+                break;
             }
+            case IF_STATEMENT_NODE: {
+                const flat_if_statement_t* const stmt = &ast->if_statements.items[index];
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_REF(tcheck, &stack, ast, stmt->condition);
+                        continue;
+                    case 1:
+                        if(!are_types_equal(tcheck->current, bool_type)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_BOOLEAN);
+                            break;
+                        }
+
+                        PUSH_REF(tcheck, &stack, ast, stmt->then);
+                        continue;
+                    case 2:
+                        if(stmt->otherwise != NULL_NODE_REF) {
+                            PUSH_REF(tcheck, &stack, ast, stmt->otherwise);
+                            continue;
+                        }
+
+                        break;
+                }
 
-            SET_RESULT_TYPE(tcheck, right);
-            break;
-        }
-        case CASTING_EXPR_NODE: {
+                break;
+            }
+            case EXPR_STATEMENT_NODE: {
+                const flat_expr_statement_t* const stmt = &ast->expr_statements.items[index];
 
-            const casting_expr_t* const expr = (casting_expr_t*)node;
+                if(frame->stage++ == 0) {
+                    PUSH_REF(tcheck, &stack, ast, stmt->expr);
+                    continue;
+                }
 
-            const type_t* const expr_type = GET_TYPE_OF(expr->expr, tcheck);
-            if (!can_cast_to(expr_type, expr->target_type)) {
-                typechecker_error(tcheck, TCHECK_CAST_ERROR);
-                return;
+                break;
             }
+            case ASSIGN_EXPR_NODE: {
+
+                const flat_assign_expr_t* const expr = &ast->assign_exprs.items[index];
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_REF(tcheck, &stack, ast, expr->lvalue);
+                        continue;
+                    case 1:
+                        frame->saved = tcheck->current;
+                        PUSH_REF(tcheck, &stack, ast, expr->rvalue);
+                        continue;
+                }
 
-            SET_RESULT_TYPE(tcheck, expr->target_type);
-            break;
-        }
-        case SUBSCRIPT_EXPR_NODE: {
+                const type_t* left = frame->saved;
+                const type_t* right = tcheck->current;
 
-            const subscript_expr_t* const expr = (subscript_expr_t*)node;
+                if(!are_types_equal(right, left)) {
+                    typechecker_error(tcheck, TCHECK_INVALID_ASSIGNMENT);
+                    break;
+                }
 
-            const type_t* type = GET_TYPE_OF(expr->lvalue, tcheck);
+                SET_RESULT_TYPE(tcheck, left);
+                break;
+            }
+            case BINARY_EXPR_NODE: {
+
+                const flat_binary_expr_t* const expr = &ast->binary_exprs.items[index];
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_REF(tcheck, &stack, ast, expr->left);
+                        continue;
+                    case 1:
+                        frame->saved = tcheck->current;
+                        PUSH_REF(tcheck, &stack, ast, expr->right);
+                        continue;
+                }
+
+                const type_t* left = frame->saved;
+                const type_t* right = tcheck->current;
+
+                if(!IS_NUMERIC_TYPE(left) || !IS_NUMERIC_TYPE(right)) {
+                    typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
+                    break;
+                }
 
-            if(type->kind != TYPE_ARRAY) {
-                typechecker_error(tcheck, TCHECK_EXPECT_ARRAY);
-                return;
+                switch(expr->op) {
+                    case PLUS:
+                    case MINUS:
+                    case STAR:
+                    case SLASH: {
+                        const type_t* result = cast_to_bigger(left, right);
+                        if(result == NULL) {
+                            typechecker_error(tcheck, TCHECK_CAST_ERROR);
+                            break;
+                        }
+
+                        SET_RESULT_TYPE(tcheck, result);
+                        break;
+                    }
+                    case LESS:
+                    case GREATER:
+                    case GREATER_EQ:
+                    case LESS_EQ:
+                        SET_RESULT_TYPE(tcheck, bool_type);
+                        break;
+                    default:
+                        break;
+                }
+
+                break;
             }
+            case UNARY_EXPR_NODE: {
+
+                const flat_unary_expr_t* const expr = &ast->unary_exprs.items[index];
+
+                if(frame->stage++ == 0) {
+                    PUSH_REF(tcheck, &stack, ast, expr->right);
+                    continue;
+                }
+
+                if(!IS_NUMERIC_TYPE(tcheck->current)) {
+                    typechecker_error(tcheck, TCHECK_EXPECT_NUMERIC);
+                }
 
-            if(!are_types_equal(GET_TYPE_OF(expr->index, tcheck), int_type)) {
-                typechecker_error(tcheck, TCHECK_EXPECT_VALID_INDEX);
-                return;
+                break;
             }
+            case CASTING_EXPR_NODE: {
 
-            SET_RESULT_TYPE(tcheck, type->underlying);
-            break;
-        }
-        case VARIABLE_EXPR_NODE: {
+                const flat_casting_expr_t* const expr = &ast->casting_exprs.items[index];
 
-            const variable_expr_t* const var = (variable_expr_t*)node;
-            const type_t* var_type = symbol_table_search(tcheck->symtbl, var->name.lexeme);
+                if(frame->stage++ == 0) {
+                    PUSH_REF(tcheck, &stack, ast, expr->expr);
+                    continue;
+                }
 
-            SET_RESULT_TYPE(tcheck, var_type);
-            break;
-        }
-        case INITIALIZER_NODE: {
+                const type_t* const target_type = type_from_id(expr->target_type);
 
-            const initializer_t* const initializer = (initializer_t*)node;
+                if (!can_cast_to(tcheck->current, target_type)) {
+                    typechecker_error(tcheck, TCHECK_CAST_ERROR);
+                    break;
+                }
 
-            const type_t* prev = NULL;
-            int count = 0;
-            for(const ast_node_t* it = initializer->init; it != NULL; it = it->next, count++) {
-                const type_t* type = GET_TYPE_OF(it, tcheck);
+                SET_RESULT_TYPE(tcheck, target_type);
+                break;
+            }
+            case SUBSCRIPT_EXPR_NODE: {
+
+                const flat_subscript_expr_t* const expr = &ast->subscript_exprs.items[index];
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_REF(tcheck, &stack, ast, expr->lvalue);
+                        continue;
+                    case 1:
+                        if(tcheck->current->kind != TYPE_ARRAY) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_ARRAY);
+                            break;
+                        }
+
+                        frame->saved = tcheck->current;
+                        PUSH_REF(tcheck, &stack, ast, expr->index);
+                        continue;
+                    case 2:
+                        if(!IS_INTEGER_TYPE(tcheck->current)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_VALID_INDEX);
+                            break;
+                        }
+
+                        SET_RESULT_TYPE(tcheck, frame->saved->underlying);
+                        break;
+                }
 
-                if(prev != NULL && !are_types_equal(prev, type)) {
-                    typechecker_error(tcheck, TCHECK_INITIALIZER_NOT_UNIFORM);
-                    return;
+                break;
+            }
+            case ELEMENT_EXPR_NODE: {
+
+                const flat_element_expr_t* const expr = &ast->element_exprs.items[index];
+
+                switch(frame->stage++) {
+                    case 0:
+                        PUSH_REF(tcheck, &stack, ast, expr->array);
+                        continue;
+                    case 1:
+                        frame->saved = element_type(tcheck->current, expr->dimensions);
+                        if(frame->saved == NULL) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_ARRAY);
+                            break;
+                        }
+
+                        PUSH_REF(tcheck, &stack, ast, expr->offset);
+                        continue;
+                    case 2:
+                        if(!are_types_equal(tcheck->current, int_type)) {
+                            typechecker_error(tcheck, TCHECK_EXPECT_VALID_INDEX);
+                            break;
+                        }
+
+                        SET_RESULT_TYPE(tcheck, frame->saved);
+                        break;
                 }
 
-                prev = type;
+                break;
             }
+            case INITIALIZER_NODE: {
 
-            prev = create_array_type(prev, count);
-            
-            SET_RESULT_TYPE(tcheck, prev);
-            break;
-        }
-        case LITERAL_NODE: {
+                const flat_initializer_t* const list = &ast->initializers.items[index];
+
+                if(frame->stage == 0) {
+                    frame->stage = 1;
+                    frame->element = 0;
+                    frame->saved = NULL;
+                } else {
+                    const type_t* type = tcheck->current;
+
+                    if(frame->saved != NULL && !are_types_equal(frame->saved, type)) {
+                        typechecker_error(tcheck, TCHECK_INITIALIZER_NOT_UNIFORM);
+                        break;
+                    }
 
-            const literal_expr_t* const lit = (literal_expr_t*)node;
-            SET_RESULT_TYPE(tcheck, lit->type);
-            break;
+                    frame->saved = type;
+                    frame->element++;
+                }
+
+                if(frame->element < list->count) {
+                    PUSH_REF(tcheck, &stack, ast, ast->elements.items[list->first + frame->element]);
+                    continue;
+                }
+
+                SET_RESULT_TYPE(tcheck, create_array_type(frame->saved, list->count));
+                break;
+            }
+            default:
+                break;
         }
+
+        stack.count--;
     }
 }
 
-bool typecheck_ast(const ast_node_t* ast, typechecker_t* tcheck) {
+#undef PUSH_NODE
+#undef PUSH_REF
+#undef SET_NODE_TYPE
 
-    for (const ast_node_t *it = ast; it != NULL; it = it->next){
-        typecheck_node(it, tcheck);
+bool typecheck_flat_ast(const flat_ast_t* ast, typechecker_t* tcheck) {
+
+    const tcheck_stack_t stack = create_tcheck_stack(tcheck);
+    const arena_mark_t mark = arena_mark(tcheck->scratch);
+
+    for(uint32_t i = 0; i < ast->decls.count; i++) {
+        typecheck_flat_node(ast, ast->decls.items[i], tcheck, stack);
+        arena_rollback(tcheck->scratch, mark);
     }
 
     return !tcheck->had_error;
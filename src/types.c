@@ -2,31 +2,136 @@
 #include "../include/memory.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <threads.h>
 
-type_t* float_type = &(type_t) {.kind = TYPE_FLOAT, .length=0, .underlying=NULL};
-type_t* int_type = &(type_t) {.kind = TYPE_INT, .length=0, .underlying=NULL};
-type_t* bool_type = &(type_t) {.kind = TYPE_BOOL, .length=0, .underlying=NULL};
+type_t* float_type = &(type_t) {.kind = TYPE_FLOAT, .id = 1, .size = 4, .length=0, .underlying=NULL};
+type_t* int_type = &(type_t) {.kind = TYPE_INT, .id = 0, .size = 8, .length=0, .underlying=NULL};
+type_t* bool_type = &(type_t) {.kind = TYPE_BOOL, .id = 2, .size = 1, .length=0, .underlying=NULL};
 
-type_t* create_array_type(const type_t* underlying, int length) {
-    type_t* t = MALLOC(type_t*, sizeof(type_t));
+type_t* i8_type = &(type_t) {.kind = TYPE_INT, .id = 3, .size = 1, .length=0, .underlying=NULL};
+type_t* i16_type = &(type_t) {.kind = TYPE_INT, .id = 4, .size = 2, .length=0, .underlying=NULL};
+type_t* i32_type = &(type_t) {.kind = TYPE_INT, .id = 5, .size = 4, .length=0, .underlying=NULL};
+type_t* f64_type = &(type_t) {.kind = TYPE_FLOAT, .id = 6, .size = 8, .length=0, .underlying=NULL};
+
+#define INITIAL_CAPACITY 64
+#define MAX_LOAD_FACTOR(capacity) ((capacity) / 4 * 3)
+
+typedef struct {
+    arena_t* arena;
+
+    // Array types, open addressing with linear probing.
+    const type_t** entries;
+    size_t capacity;
+
+    // Every type indexed by its id, the primitive types come first.
+    const type_t** types;
+    size_t count;
+
+    // Array types are created while parsing, possibly on several threads.
+    mtx_t lock;
+} type_table_t;
+
+static type_table_t table = {0};
+static once_flag table_once = ONCE_FLAG_INIT;
+
+static inline uint32_t hash_array_type(const type_t* underlying, int length) {
+    uint64_t hash = ((uint64_t)underlying->id << 32) | (uint32_t)length;
+    hash *= 0x9e3779b97f4a7c15ull;
+
+    return (uint32_t)(hash >> 32);
+}
+
+static void init_type_table() {
+    table.arena = create_arena(ARENA_DEFAULT_CHUNK_SIZE);
+    table.capacity = INITIAL_CAPACITY;
+    table.entries = ARENA_MALLOC(table.arena, const type_t**, sizeof(const type_t*) * table.capacity);
+    table.types = ARENA_MALLOC(table.arena, const type_t**, sizeof(const type_t*) * table.capacity);
+
+    type_t* const primitives[PRIMITIVE_TYPES_COUNT] = {
+        int_type, float_type, bool_type, i8_type, i16_type, i32_type, f64_type
+    };
+
+    for(size_t i = 0; i < PRIMITIVE_TYPES_COUNT; i++) {
+        table.types[primitives[i]->id] = primitives[i];
+    }
+
+    table.count = PRIMITIVE_TYPES_COUNT;
+
+    mtx_init(&table.lock, mtx_plain);
+}
+
+static inline const type_t** find_entry(const type_t** entries, size_t capacity,
+                                        const type_t* underlying, int length) {
+    const size_t mask = capacity - 1;
+
+    for(size_t i = hash_array_type(underlying, length) & mask; ; i = (i + 1) & mask) {
+        const type_t* const t = entries[i];
+
+        if(t == NULL || (t->underlying == underlying && t->length == length)) {
+            return &entries[i];
+        }
+    }
+}
+
+static void grow_type_table() {
+    const size_t capacity = table.capacity * 2;
+    const type_t** const entries = ARENA_MALLOC(table.arena, const type_t**,
+                                                sizeof(const type_t*) * capacity);
+
+    for(size_t i = 0; i < table.capacity; i++) {
+        const type_t* const t = table.entries[i];
+        if(t == NULL) continue;
+
+        *find_entry(entries, capacity, t->underlying, t->length) = t;
+    }
+
+    const type_t** const types = ARENA_MALLOC(table.arena, const type_t**,
+                                              sizeof(const type_t*) * capacity);
+    memcpy(types, table.types, sizeof(const type_t*) * table.count);
+
+    table.entries = entries;
+    table.types = types;
+    table.capacity = capacity;
+}
+
+const type_t* create_array_type(const type_t* underlying, int length) {
+    call_once(&table_once, init_type_table);
+    mtx_lock(&table.lock);
+
+    const type_t** entry = find_entry(table.entries, table.capacity, underlying, length);
+    if(*entry != NULL) {
+        mtx_unlock(&table.lock);
+        return *entry;
+    }
+
+    if(table.count + 1 > MAX_LOAD_FACTOR(table.capacity)) {
+        grow_type_table();
+        entry = find_entry(table.entries, table.capacity, underlying, length);
+    }
+
+    type_t* t = ARENA_MALLOC(table.arena, type_t*, sizeof(type_t));
 
     t->kind = TYPE_ARRAY;
+    t->id = (uint32_t)table.count;
     t->underlying = underlying;
     t->length = length;
 
+    table.types[table.count++] = t;
+    *entry = t;
+
+    mtx_unlock(&table.lock);
     return t;
 }
 
-bool are_types_equal(const type_t* t1, const type_t* t2) {
+const type_t* type_from_id(uint32_t id) {
+    call_once(&table_once, init_type_table);
 
-    if(t1->kind != t2->kind) return false;
-    
-    if(IS_ARRAY(t1)) {
-        if(t1->length != t2->length) return false;
-        return are_types_equal(t1->underlying, t2->underlying);
-    }
+    return table.types[id];
+}
 
-    return true;
+inline size_t types_count() {
+    return table.arena != NULL ? table.count : PRIMITIVE_TYPES_COUNT;
 }
 
 bool can_cast_to(const type_t* from, const type_t* to) {
@@ -50,7 +155,9 @@ inline const type_t* cast_to_bigger(const type_t* t1, const type_t* t2) {
     switch(t1->kind) {
         case TYPE_INT:
         case TYPE_FLOAT:
-            return t2->kind == TYPE_FLOAT ? t2 : t1;
+            if(t1->kind != t2->kind) return t2->kind == TYPE_FLOAT ? t2 : t1;
+
+            return t2->size > t1->size ? t2 : t1;
         case TYPE_BOOL:
             return IS_NUMERIC_TYPE(t2) ? t2 : t1;
         case TYPE_ARRAY:
@@ -63,10 +170,18 @@ inline const type_t* cast_to_bigger(const type_t* t1, const type_t* t2) {
 inline void print_type(const type_t* restrict t) {
     switch(t->kind) {
         case TYPE_INT:
-            printf("integer");
+            if(t->size == 8) {
+                printf("integer");
+            } else {
+                printf("i%u", t->size * 8);
+            }
             break;
         case TYPE_FLOAT:
-            printf("float");
+            if(t->size == 4) {
+                printf("float");
+            } else {
+                printf("f%u", t->size * 8);
+            }
             break;
         case TYPE_BOOL:
             printf("bool");
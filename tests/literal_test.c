@@ -0,0 +1,68 @@
+#include "../include/literal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Float literals and the float they round to, or too_large when
+// parse_float_literal must refuse them.
+
+#define ZEROS "000000000000000000000000000000"
+#define NINES "999999999999999999999999999999"
+
+// The smallest subnormal, 2^-149, and half of it.
+#define MIN_SUBNORMAL "0.0000000000000000000000000000000000000000000014012984643248170709237295832899161312802619418765157717570682838897910826858606014866381883621215820312"
+#define HALF_MIN_SUBNORMAL "0.000000000000000000000000000000000000000000000700649232162408535461864791644958065640130970938257885878534141944895541342930300743319094181060791015625"
+
+typedef struct {
+    const char* lexeme;
+    float value;
+    bool too_large;
+} literal_case_t;
+
+static const literal_case_t cases[] = {
+    // Short ones, fast paths.
+    { "0.0", 0x0p+0f, false },
+    { "0.1", 0x1.99999ap-4f, false },
+    { "3.4028235", 0x1.b38fb8p+1f, false },
+    { "00000000001.5000", 0x1.8p+0f, false },
+
+    // Halfway between two floats, ties go to the even one.
+    { "16777217.0", 0x1p+24f, false },
+    { "16777219.0", 0x1.000004p+24f, false },
+    { "1.000000059604644775390625", 0x1p+0f, false },
+    { "1.00000005960464477539062500000000000000000000000001", 0x1.000002p+0f, false },
+    { HALF_MIN_SUBNORMAL, 0x0p+0f, false },
+    { HALF_MIN_SUBNORMAL "1", 0x1p-149f, false },
+
+    // Long digit runs, past the digits kept.
+    { "16777217." ZEROS ZEROS ZEROS ZEROS ZEROS "1", 0x1.000002p+24f, false },
+    { "16777216." NINES NINES NINES NINES NINES "9", 0x1p+24f, false },
+    { MIN_SUBNORMAL, 0x1p-149f, false },
+    { "0.000000000000000000000000000000000000011754943508222875079687365372222456778186655567720875215087517062784172594547271728515625", 0x1p-126f, false },
+
+    // Around FLT_MAX, and past the halfway point to the next power of two.
+    { "340282346638528859811704183484516925440.0", 0x1.fffffep+127f, false },
+    { "340282356779733661637539395458142568447.0", 0x1.fffffep+127f, false },
+    { "340282356779733661637539395458142568448.0", 0.0f, true },
+    { "1000000000000000000000000000000000000000.0", 0.0f, true },
+    { "1" ZEROS ZEROS ".0", 0.0f, true },
+};
+
+int main() {
+    int failed = 0;
+
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const literal_case_t* test = &cases[i];
+
+        float value = 0.0f;
+        const bool parsed = parse_float_literal(new_string_view_from_cstr(test->lexeme), &value);
+
+        if(parsed == test->too_large || (parsed && memcmp(&value, &test->value, sizeof(value)) != 0)) {
+            fprintf(stderr, "FAIL: %s gives %s%a\n", test->lexeme, parsed ? "" : "too large ", value);
+            failed++;
+        }
+    }
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
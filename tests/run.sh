@@ -0,0 +1,62 @@
+#!/bin/sh
+# Runs the tests against the binary given as first argument.
+#
+#   tests/run.sh ./simplelang
+
+BIN=${1:-./simplelang}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+FAILED=0
+
+trap 'rm -rf "$TMP"' EXIT
+
+fail() {
+    echo "FAIL: $1"
+    FAILED=$((FAILED + 1))
+}
+
+# Each tests/cases/NAME.sl is run with the options in NAME.args, if any, and
+# its output, stdout then stderr, must be NAME.out.
+for source in "$DIR"/cases/*.sl; do
+    name=$(basename "$source" .sl)
+    args=""
+    [ -f "$DIR/cases/$name.args" ] && args=$(cat "$DIR/cases/$name.args")
+
+    # shellcheck disable=SC2086
+    "$BIN" $args "$source" > "$TMP/stdout" 2> "$TMP/stderr"
+    cat "$TMP/stdout" "$TMP/stderr" > "$TMP/$name.out"
+    cmp -s "$DIR/cases/$name.out" "$TMP/$name.out" || fail "$name"
+done
+
+# One declaration spanning many stream windows of 64 KiB, between smaller
+# ones and an `if` whose `else` comes after a top-level `;`.
+generate_stream() {
+    awk -v n="$1" 'BEGIN {
+        print "var a integer = 1;"
+        printf "var big integer[%d][2] = {", n
+        for(i = 0; i < n; i++) printf "%s{%d, %d}", (i > 0 ? ", " : ""), i, -i
+        print "};"
+        print "if a < 2 then a = 2;"
+        print "else a = 3;"
+        print "big[1][0] = a;"
+    }' > "$2"
+}
+
+# It must parse the same as the whole source.
+generate_stream 100000 "$TMP/stream.sl"
+"$BIN" "$TMP/stream.sl" > "$TMP/expected.out" 2>&1
+"$BIN" --stream "$TMP/stream.sl" > "$TMP/stream.out" 2>&1
+cmp -s "$TMP/expected.out" "$TMP/stream.out" ||
+    fail "stream: --stream differs from the whole source"
+
+# And in linear time, not parsing the declaration again after each window.
+generate_stream 500000 "$TMP/large.sl"
+timeout 10 "$BIN" --check "$TMP/large.sl" > /dev/null 2>&1 ||
+    fail "stream: --check of a large declaration failed or timed out"
+
+if [ "$FAILED" -ne 0 ]; then
+    echo "$FAILED test(s) failed."
+    exit 1
+fi
+
+echo "All tests passed."